@@ -0,0 +1,563 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "cbitphoto.h"
+#include "thread_pool.h"
+#include "sat.h"
+
+// number of reusable scratch buffers held by a context
+#define CBP_SCRATCH_SLOTS 2
+#define CBP_SCRATCH_FIELD 0   // radius map or gradient magnitudes
+#define CBP_SCRATCH_SUMS  1
+
+struct _cbp_context {
+  pthread_mutex_t lock;   // serializes calls on this context
+  ThreadPool *pool;
+
+  // scratch buffers, grown on demand and kept between calls
+  unsigned char *scratch[CBP_SCRATCH_SLOTS];
+  size_t scratch_size[CBP_SCRATCH_SLOTS];
+};
+
+/* arguments shared by the row loops below */
+typedef struct _cbp_job {
+  const CbpView *src;
+  const CbpView *dst;
+  const double *field;      // radius map or gradient magnitudes
+  double *out;
+  int cols;                 // width, for loops without a view
+  double cx;
+  double cy;
+  double s;
+  int threshold;
+} CbpJob;
+
+// address of pixel (r, c) of a view
+#define PX(v, r, c) ((v)->data + (ptrdiff_t)(r) * (v)->stride + (ptrdiff_t)(c) * 3)
+
+
+/* HELPER for every operation:
+ * check that a view is usable
+ */
+static int view_ok(const CbpView *v) {
+  return v && v->data && v->rows > 0 && v->cols > 0 && v->stride >= (ptrdiff_t)v->cols * 3;
+}
+
+/* HELPER for every operation:
+ * 1 if the memory spanned by two views overlaps
+ */
+static int views_overlap(const CbpView *a, const CbpView *b) {
+  const unsigned char *a_end = PX(a, a->rows - 1, a->cols);
+  const unsigned char *b_end = PX(b, b->rows - 1, b->cols);
+  return a->data < b_end && b->data < a_end;
+}
+
+/* HELPER for the pointwise operations:
+ * 1 if dst is exactly src, i.e. the operation runs in place
+ */
+static int same_view(const CbpView *a, const CbpView *b) {
+  return a->data == b->data && a->stride == b->stride;
+}
+
+/* HELPER for the operations needing temporary memory:
+ * return scratch buffer slot of at least size bytes, reusing it
+ * between calls; NULL if it cannot be grown
+ */
+static unsigned char *cbp_scratch(CbpContext *ctx, int slot, size_t size) {
+  if (ctx->scratch_size[slot] < size) {
+    unsigned char *buf = realloc(ctx->scratch[slot], size);
+    if (!buf) {
+      return NULL;
+    }
+    ctx->scratch[slot] = buf;
+    ctx->scratch_size[slot] = size;
+  }
+  return ctx->scratch[slot];
+}
+
+
+int cbp_context_create(CbpContext **ctx, int nthreads) {
+  if (!ctx || nthreads < 0) {
+    return CBP_ERR_ARG;
+  }
+  *ctx = NULL;
+
+  CbpContext *c = calloc(1, sizeof(CbpContext));
+  if (!c) {
+    return CBP_ERR_NOMEM;
+  }
+  c->pool = make_pool(nthreads);
+  if (!c->pool) {
+    free(c);
+    return CBP_ERR_THREAD;
+  }
+  pthread_mutex_init(&c->lock, NULL);
+
+  *ctx = c;
+  return CBP_OK;
+}
+
+void cbp_context_destroy(CbpContext *ctx) {
+  if (!ctx) {
+    return;
+  }
+  free_pool(&ctx->pool);
+  for (int i = 0; i < CBP_SCRATCH_SLOTS; i++) {
+    free(ctx->scratch[i]);
+  }
+  pthread_mutex_destroy(&ctx->lock);
+  free(ctx);
+}
+
+const char *cbp_strerror(int status) {
+  switch (status) {
+    case CBP_OK:         return "success";
+    case CBP_ERR_ARG:    return "invalid argument";
+    case CBP_ERR_NOMEM:  return "out of memory";
+    case CBP_ERR_RANGE:  return "parameter out of range";
+    case CBP_ERR_THREAD: return "failed to start threads";
+    case CBP_ERR_ALIAS:  return "source and destination overlap";
+    default:             return "unknown error";
+  }
+}
+
+
+/* ______swap______ */
+static void swap_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  for (int r = begin; r < end; r++) {
+    const unsigned char *s = PX(job->src, r, 0);
+    unsigned char *d = PX(job->dst, r, 0);
+    for (int c = 0; c < job->src->cols; c++) {
+      unsigned char red = s[3*c];
+      d[3*c] = s[3*c+1];
+      d[3*c+1] = s[3*c+2];
+      d[3*c+2] = red;
+    }
+  }
+}
+
+int cbp_swap(CbpContext *ctx, const CbpView *src, const CbpView *dst) {
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows || dst->cols != src->cols) {
+    return CBP_ERR_ARG;
+  }
+  // in-place is fine, but a shifted overlap would read modified pixels
+  if (!same_view(src, dst) && views_overlap(src, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+  CbpJob job = { .src = src, .dst = dst };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, src->rows, swap_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+
+/* ______invert______ */
+static void invert_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  for (int r = begin; r < end; r++) {
+    const unsigned char *s = PX(job->src, r, 0);
+    unsigned char *d = PX(job->dst, r, 0);
+    for (int i = 0; i < job->src->cols * 3; i++) {
+      d[i] = 255 - s[i];
+    }
+  }
+}
+
+int cbp_invert(CbpContext *ctx, const CbpView *src, const CbpView *dst) {
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows || dst->cols != src->cols) {
+    return CBP_ERR_ARG;
+  }
+  if (!same_view(src, dst) && views_overlap(src, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+  CbpJob job = { .src = src, .dst = dst };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, src->rows, invert_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+
+/* ______zoom_out______ */
+static void zoomout_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  for (int r = begin; r < end; r++) {
+    const unsigned char *top = PX(job->src, 2*r, 0);
+    const unsigned char *bottom = PX(job->src, 2*r+1, 0);
+    unsigned char *d = PX(job->dst, r, 0);
+    for (int c = 0; c < job->dst->cols; c++) {
+      for (int k = 0; k < 3; k++) {
+        d[3*c+k] = (top[6*c+k] + top[6*c+3+k] + bottom[6*c+k] + bottom[6*c+3+k]) / 4;
+      }
+    }
+  }
+}
+
+int cbp_zoomout(CbpContext *ctx, const CbpView *src, const CbpView *dst) {
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows / 2 || dst->cols != src->cols / 2) {
+    return CBP_ERR_ARG;
+  }
+  if (views_overlap(src, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+  CbpJob job = { .src = src, .dst = dst };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, dst->rows, zoomout_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+
+/* _______rotate-right________ */
+static void rotate_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  int src_rows = job->src->rows;
+  // row r of the result is column r of the source, read bottom to top
+  for (int r = begin; r < end; r++) {
+    unsigned char *d = PX(job->dst, r, 0);
+    for (int c = 0; c < src_rows; c++) {
+      memcpy(d + 3*c, PX(job->src, src_rows - 1 - c, r), 3);
+    }
+  }
+}
+
+int cbp_rotateright(CbpContext *ctx, const CbpView *src, const CbpView *dst) {
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->cols || dst->cols != src->rows) {
+    return CBP_ERR_ARG;
+  }
+  if (views_overlap(src, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+  CbpJob job = { .src = src, .dst = dst };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, dst->rows, rotate_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+
+/* ________Swirl effect_________ */
+static void radius_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  int cols = job->cols;
+  double cx = job->cx, cy = job->cy;
+  for (int r = begin; r < end; r++) {
+    for (int c = 0; c < cols; c++) {
+      job->out[(size_t)r * cols + c] = sqrt((c-cx)*(c-cx)+(r-cy)*(r-cy));
+    }
+  }
+}
+
+static void swirl_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  const CbpView *src = job->src;
+  double cx = job->cx, cy = job->cy, s = job->s;
+
+  for (int r = begin; r < end; r++) {
+    unsigned char *d = PX(job->dst, r, 0);
+    for (int c = 0; c < src->cols; c++) {
+      double a = job->field[(size_t)r * src->cols + c]/s;
+
+      // the coordinates for the swirl image
+      int sC = (c-cx)*cos(a)-(r-cy)*sin(a)+cx;
+      int sR = (c-cx)*sin(a)+(r-cy)*cos(a)+cy;
+
+      if (!(sR > src->rows-1 || sC > src->cols-1 || sC < 0 || sR < 0)) {
+        memcpy(d + 3*c, PX(src, sR, sC), 3);
+      }
+      else {
+        memset(d + 3*c, 0, 3);
+      }
+    }
+  }
+}
+
+/* HELPER for the swirl operations:
+ * check the center and resolve -1 to the middle of the image
+ */
+static int swirl_center(int rows, int cols, double *cx, double *cy) {
+  if (!isfinite(*cx) || !isfinite(*cy) || *cx < -1 || *cy < -1) {
+    return CBP_ERR_RANGE;
+  }
+  if (*cx == -1) {
+    *cx = cols/2.0;
+  }
+  if (*cy == -1) {
+    *cy = rows/2.0;
+  }
+  return CBP_OK;
+}
+
+/* HELPER for the swirl operations:
+ * resample src into dst; call with the context locked
+ */
+static int swirl_locked(CbpContext *ctx, const CbpView *src, const CbpView *dst,
+                        const double *radius, double cx, double cy, double s) {
+  if (!view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows || dst->cols != src->cols) {
+    return CBP_ERR_ARG;
+  }
+  // a zero strength would turn every angle into inf or NaN
+  if (!isfinite(s) || s <= 0 || swirl_center(src->rows, src->cols, &cx, &cy)) {
+    return CBP_ERR_RANGE;
+  }
+  if (views_overlap(src, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+
+  CbpJob job = { .src = src, .dst = dst, .cx = cx, .cy = cy, .s = s };
+  if (!radius) {
+    double *map = (double *)cbp_scratch(ctx, CBP_SCRATCH_FIELD,
+                                        sizeof(double) * src->rows * src->cols);
+    if (!map) {
+      return CBP_ERR_NOMEM;
+    }
+    CbpJob radius_job = { .out = map, .cx = cx, .cy = cy, .cols = src->cols };
+    pool_run(ctx->pool, src->rows, radius_rows, &radius_job);
+    radius = map;
+  }
+  job.field = radius;
+  pool_run(ctx->pool, src->rows, swirl_rows, &job);
+  return CBP_OK;
+}
+
+int cbp_swirl(CbpContext *ctx, const CbpView *src, const CbpView *dst,
+              double cx, double cy, double s) {
+  if (!ctx) {
+    return CBP_ERR_ARG;
+  }
+  pthread_mutex_lock(&ctx->lock);
+  int status = swirl_locked(ctx, src, dst, NULL, cx, cy, s);
+  pthread_mutex_unlock(&ctx->lock);
+  return status;
+}
+
+int cbp_radius_map(CbpContext *ctx, int rows, int cols, double cx, double cy,
+                   double *radius) {
+  if (!ctx || !radius || rows <= 0 || cols <= 0) {
+    return CBP_ERR_ARG;
+  }
+  if (swirl_center(rows, cols, &cx, &cy)) {
+    return CBP_ERR_RANGE;
+  }
+  CbpJob job = { .out = radius, .cx = cx, .cy = cy, .cols = cols };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, rows, radius_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+int cbp_swirl_from_radius(CbpContext *ctx, const CbpView *src, const CbpView *dst,
+                          const double *radius, double cx, double cy, double s) {
+  if (!ctx || !radius) {
+    return CBP_ERR_ARG;
+  }
+  pthread_mutex_lock(&ctx->lock);
+  int status = swirl_locked(ctx, src, dst, radius, cx, cy, s);
+  pthread_mutex_unlock(&ctx->lock);
+  return status;
+}
+
+
+/* _______edges________ */
+unsigned char cbp_gray(const unsigned char *rgb) {
+  // NTSC standard conversion
+  return (unsigned char)( (0.3 * (double)rgb[0]) +
+                          (0.59 * (double)rgb[1]) +
+                          (0.11 * (double)rgb[2]) );
+}
+
+static void gray_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  for (int r = begin; r < end; r++) {
+    const unsigned char *s = PX(job->src, r, 0);
+    unsigned char *d = PX(job->dst, r, 0);
+    for (int c = 0; c < job->src->cols; c++) {
+      unsigned char v = cbp_gray(s + 3*c);
+      d[3*c] = d[3*c+1] = d[3*c+2] = v;
+    }
+  }
+}
+
+static void gradient_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  const CbpView *gray = job->src;
+  int rows = gray->rows;
+  int cols = gray->cols;
+
+  for (int r = begin; r < end; r++) {
+    double *m = job->out + (size_t)r * cols;
+    if (r == 0 || r == rows-1) {
+      memset(m, 0, sizeof(double) * cols);
+      continue;
+    }
+    const unsigned char *g = PX(gray, r, 0);
+    const unsigned char *up = PX(gray, r-1, 0);
+    const unsigned char *down = PX(gray, r+1, 0);
+    m[0] = m[cols-1] = 0;
+    for (int c = 1; c < cols-1; c++) {
+      double x = 1.0 * (g[3*(c+1)] - g[3*(c-1)])/2;
+      double y = 1.0 * (down[3*c] - up[3*c])/2;
+      m[c] = sqrt(x*x+y*y);
+    }
+  }
+}
+
+static void threshold_rows(void *arg, int begin, int end) {
+  const CbpJob *job = arg;
+  int rows = job->src->rows;
+  int cols = job->src->cols;
+
+  for (int r = begin; r < end; r++) {
+    const unsigned char *g = PX(job->src, r, 0);
+    const double *m = job->field + (size_t)r * cols;
+    unsigned char *d = PX(job->dst, r, 0);
+    for (int c = 0; c < cols; c++) {
+      // keep the boundary as grayscale
+      if (r == 0 || c == 0 || r == rows-1 || c == cols-1) {
+        memmove(d + 3*c, g + 3*c, 3);
+      }
+      else {
+        unsigned char v = m[c] > job->threshold ? 0 : 255;
+        d[3*c] = d[3*c+1] = d[3*c+2] = v;
+      }
+    }
+  }
+}
+
+int cbp_grayscale(CbpContext *ctx, const CbpView *src, const CbpView *dst) {
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows || dst->cols != src->cols) {
+    return CBP_ERR_ARG;
+  }
+  if (!same_view(src, dst) && views_overlap(src, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+  CbpJob job = { .src = src, .dst = dst };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, src->rows, gray_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+int cbp_gradient_magnitude(CbpContext *ctx, const CbpView *gray, double *mag) {
+  if (!ctx || !view_ok(gray) || !mag) {
+    return CBP_ERR_ARG;
+  }
+  CbpJob job = { .src = gray, .out = mag };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, gray->rows, gradient_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+int cbp_threshold_edges(CbpContext *ctx, const CbpView *gray, const double *mag,
+                        const CbpView *dst, int threshold) {
+  if (!ctx || !view_ok(gray) || !view_ok(dst) || !mag ||
+      dst->rows != gray->rows || dst->cols != gray->cols) {
+    return CBP_ERR_ARG;
+  }
+  if (!same_view(gray, dst) && views_overlap(gray, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+  CbpJob job = { .src = gray, .dst = dst, .field = mag, .threshold = threshold };
+  pthread_mutex_lock(&ctx->lock);
+  pool_run(ctx->pool, gray->rows, threshold_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+int cbp_edge_detection(CbpContext *ctx, const CbpView *src, const CbpView *dst,
+                       int threshold) {
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows || dst->cols != src->cols) {
+    return CBP_ERR_ARG;
+  }
+  if (threshold < 0) {
+    return CBP_ERR_RANGE;
+  }
+  if (!same_view(src, dst) && views_overlap(src, dst)) {
+    return CBP_ERR_ALIAS;
+  }
+
+  // grayscale into dst, then threshold dst's own gradients in place
+  pthread_mutex_lock(&ctx->lock);
+  double *mag = (double *)cbp_scratch(ctx, CBP_SCRATCH_FIELD,
+                                      sizeof(double) * src->rows * src->cols);
+  if (!mag) {
+    pthread_mutex_unlock(&ctx->lock);
+    return CBP_ERR_NOMEM;
+  }
+  CbpJob job = { .src = src, .dst = dst, .out = mag, .field = mag, .threshold = threshold };
+  pool_run(ctx->pool, src->rows, gray_rows, &job);
+  job.src = dst;
+  pool_run(ctx->pool, src->rows, gradient_rows, &job);
+  pool_run(ctx->pool, src->rows, threshold_rows, &job);
+  pthread_mutex_unlock(&ctx->lock);
+  return CBP_OK;
+}
+
+
+/* HELPER for the summed-area table operations:
+ * build the table of src in the context's scratch memory;
+ * call with the context locked
+ */
+static int cbp_sum_table(CbpContext *ctx, const CbpView *src, SumTable *t) {
+  size_t size = sum_table_entries(src->rows, src->cols) * sizeof(unsigned long long);
+  unsigned long long *sum = (unsigned long long *)cbp_scratch(ctx, CBP_SCRATCH_SUMS, size);
+  if (!sum) {
+    return CBP_ERR_NOMEM;
+  }
+  build_sum_table(t, sum, src->data, src->rows, src->cols, src->stride, ctx->pool);
+  return CBP_OK;
+}
+
+/* ______blur______ */
+int cbp_box_blur(CbpContext *ctx, const CbpView *src, const CbpView *dst, int radius) {
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows || dst->cols != src->cols) {
+    return CBP_ERR_ARG;
+  }
+  if (radius < 0) {
+    return CBP_ERR_RANGE;
+  }
+
+  // dst is only written from the table, so any overlap is fine
+  pthread_mutex_lock(&ctx->lock);
+  SumTable t;
+  int status = cbp_sum_table(ctx, src, &t);
+  if (status == CBP_OK) {
+    sum_table_blur(&t, radius, dst->data, dst->stride, ctx->pool);
+  }
+  pthread_mutex_unlock(&ctx->lock);
+  return status;
+}
+
+/* ______downscale______ */
+int cbp_downscale(CbpContext *ctx, const CbpView *src, const CbpView *dst, int n) {
+  if (n < 1) {
+    return CBP_ERR_RANGE;
+  }
+  if (!ctx || !view_ok(src) || !view_ok(dst) ||
+      dst->rows != src->rows / n || dst->cols != src->cols / n) {
+    return CBP_ERR_ARG;
+  }
+
+  pthread_mutex_lock(&ctx->lock);
+  SumTable t;
+  int status = cbp_sum_table(ctx, src, &t);
+  if (status == CBP_OK) {
+    sum_table_downscale(&t, n, dst->data, dst->stride, ctx->pool);
+  }
+  pthread_mutex_unlock(&ctx->lock);
+  return status;
+}
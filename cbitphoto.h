@@ -0,0 +1,127 @@
+#ifndef CBITPHOTO_H
+#define CBITPHOTO_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* libcbitphoto: the image operations of ./project as a reentrant
+ * library. All operations work on caller-owned buffers described by
+ * a CbpView, return a status code instead of printing, and never
+ * free or reallocate what they are given.
+ *
+ * A CbpContext holds a thread pool and reusable scratch buffers.
+ * Calls on one context are serialized internally, so a context may be
+ * shared between threads; use one context per thread to run
+ * operations concurrently.
+ */
+
+/* status codes returned by every function */
+#define CBP_OK             0
+#define CBP_ERR_ARG       -1   // NULL pointer, bad size or stride
+#define CBP_ERR_NOMEM     -2   // allocation failed
+#define CBP_ERR_RANGE     -3   // parameter out of range
+#define CBP_ERR_THREAD    -4   // thread creation failed
+#define CBP_ERR_ALIAS     -5   // source and destination overlap
+
+/* an RGB image with 3 bytes per pixel; row r starts at
+ * data + r * stride, and stride must be at least 3 * cols */
+typedef struct _cbp_view {
+  unsigned char *data;
+  int rows;
+  int cols;
+  ptrdiff_t stride;
+} CbpView;
+
+typedef struct _cbp_context CbpContext;
+
+/* the library is built with hidden visibility; only the functions
+ * marked CBP_API are exported from the shared object */
+#if defined(__GNUC__) && __GNUC__ >= 4
+#define CBP_API __attribute__((visibility("default")))
+#else
+#define CBP_API
+#endif
+
+
+/* create a context running operations on nthreads threads
+ * (0 = one per online CPU) and store it in *ctx */
+CBP_API int cbp_context_create(CbpContext **ctx, int nthreads);
+
+/* stop the context's threads and release its buffers */
+CBP_API void cbp_context_destroy(CbpContext *ctx);
+
+/* short description of a status code */
+CBP_API const char *cbp_strerror(int status);
+
+
+/* swap color channels (r,g,b) -> (g,b,r); dst may be src */
+CBP_API int cbp_swap(CbpContext *ctx, const CbpView *src, const CbpView *dst);
+
+/* invert the intensity of each channel; dst may be src */
+CBP_API int cbp_invert(CbpContext *ctx, const CbpView *src, const CbpView *dst);
+
+/* average 2x2 blocks; dst must be (src rows/2) x (src cols/2) */
+CBP_API int cbp_zoomout(CbpContext *ctx, const CbpView *src, const CbpView *dst);
+
+/* rotate clockwise 90 degrees; dst must be (src cols) x (src rows)
+ * and must not overlap src */
+CBP_API int cbp_rotateright(CbpContext *ctx, const CbpView *src, const CbpView *dst);
+
+/* whirlpool effect around (cx, cy) with strength s > 0; a center of
+ * -1 means the middle of the image. dst must match src and not overlap it */
+CBP_API int cbp_swirl(CbpContext *ctx, const CbpView *src, const CbpView *dst,
+                      double cx, double cy, double s);
+
+/* distance of every pixel of a rows x cols image from (cx, cy), for
+ * cbp_swirl_from_radius; radius holds rows*cols values */
+CBP_API int cbp_radius_map(CbpContext *ctx, int rows, int cols, double cx, double cy,
+                           double *radius);
+
+/* cbp_swirl using a map from cbp_radius_map with the same center,
+ * so several strengths can share one map */
+CBP_API int cbp_swirl_from_radius(CbpContext *ctx, const CbpView *src, const CbpView *dst,
+                                  const double *radius, double cx, double cy, double s);
+
+/* grayscale gradient thresholding: interior pixels with gradient
+ * magnitude above threshold become black, others white, and the
+ * boundary keeps its grayscale value. dst must match src; it may be
+ * src but must not otherwise overlap it */
+CBP_API int cbp_edge_detection(CbpContext *ctx, const CbpView *src, const CbpView *dst,
+                               int threshold);
+
+/* set all three channels of each pixel to its NTSC grayscale
+ * intensity (see cbp_gray); dst may be src */
+CBP_API int cbp_grayscale(CbpContext *ctx, const CbpView *src, const CbpView *dst);
+
+/* gradient magnitude of every interior pixel of a grayscale image
+ * (from cbp_grayscale; only the first channel is read); mag holds
+ * rows*cols values and boundary entries are set to 0 */
+CBP_API int cbp_gradient_magnitude(CbpContext *ctx, const CbpView *gray, double *mag);
+
+/* threshold a field from cbp_gradient_magnitude into dst as in
+ * cbp_edge_detection, copying the boundary from gray; dst may be gray */
+CBP_API int cbp_threshold_edges(CbpContext *ctx, const CbpView *gray, const double *mag,
+                                const CbpView *dst, int threshold);
+
+/* NTSC grayscale intensity of one RGB pixel */
+CBP_API unsigned char cbp_gray(const unsigned char *rgb);
+
+/* box blur: each pixel becomes the average of the (2*radius+1)^2
+ * window around it, clipped to the image. Uses a summed-area table,
+ * so the cost per pixel does not depend on radius. dst must match src;
+ * it may overlap src */
+CBP_API int cbp_box_blur(CbpContext *ctx, const CbpView *src, const CbpView *dst, int radius);
+
+/* average each n x n block into one pixel; dst must be
+ * (src rows/n) x (src cols/n). Constant cost per pixel for any n;
+ * dst may overlap src */
+CBP_API int cbp_downscale(CbpContext *ctx, const CbpView *src, const CbpView *dst, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,164 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "histogram.h"
+#include "cbitphoto.h"
+
+// interleaved copies of each bin array, so consecutive equal values
+// update different counters instead of waiting on the same one
+#define HIST_LANES 4
+
+/* arguments shared by the counting loops below */
+typedef struct _hist_job {
+  const unsigned char *data;
+  const double *mag;
+  int cols;
+  ptrdiff_t stride;
+  pthread_mutex_t lock;           // guards the merge into the results
+  Histogram *h;
+  unsigned long long *bins;
+} HistJob;
+
+/* HELPER for compute_histogram:
+ * count rows [begin, end) into private bins, then merge them
+ */
+static void count_rows(void *arg, int begin, int end) {
+  HistJob *job = arg;
+  unsigned int counts[4][HIST_LANES][HIST_BINS];
+  memset(counts, 0, sizeof(counts));
+
+  for (int r = begin; r < end; r++) {
+    const unsigned char *p = job->data + r * job->stride;
+    int c = 0;
+    for (; c + HIST_LANES <= job->cols; c += HIST_LANES) {
+      for (int l = 0; l < HIST_LANES; l++) {
+        const unsigned char *q = p + 3 * (c + l);
+        counts[0][l][q[0]]++;
+        counts[1][l][q[1]]++;
+        counts[2][l][q[2]]++;
+        counts[3][l][cbp_gray(q)]++;
+      }
+    }
+    for (; c < job->cols; c++) {
+      const unsigned char *q = p + 3 * c;
+      counts[0][0][q[0]]++;
+      counts[1][0][q[1]]++;
+      counts[2][0][q[2]]++;
+      counts[3][0][cbp_gray(q)]++;
+    }
+  }
+
+  pthread_mutex_lock(&job->lock);
+  unsigned long long *out[4] = {job->h->r, job->h->g, job->h->b, job->h->luma};
+  for (int k = 0; k < 4; k++) {
+    for (int l = 0; l < HIST_LANES; l++) {
+      for (int i = 0; i < HIST_BINS; i++) {
+        out[k][i] += counts[k][l][i];
+      }
+    }
+  }
+  job->h->total += (unsigned long long)(end - begin) * job->cols;
+  pthread_mutex_unlock(&job->lock);
+}
+
+void compute_histogram(Histogram *h, const unsigned char *data, int rows, int cols,
+                       ptrdiff_t stride, ThreadPool *pool) {
+  memset(h, 0, sizeof(Histogram));
+  HistJob job = { .data = data, .cols = cols, .stride = stride, .h = h };
+  pthread_mutex_init(&job.lock, NULL);
+  pool_run(pool, rows, count_rows, &job);
+  pthread_mutex_destroy(&job.lock);
+}
+
+/* HELPER for gradient_histogram:
+ * count interior rows [begin, end) into private bins, then merge them
+ */
+static void count_gradient_rows(void *arg, int begin, int end) {
+  HistJob *job = arg;
+  unsigned int counts[HIST_LANES][HIST_BINS];
+  memset(counts, 0, sizeof(counts));
+
+  int cols = job->cols;
+  for (int r = begin; r < end; r++) {
+    // skip the boundary, where no gradient is computed
+    const double *m = job->mag + (size_t)(r + 1) * cols;
+    int c = 1;
+    for (; c + HIST_LANES <= cols - 1; c += HIST_LANES) {
+      for (int l = 0; l < HIST_LANES; l++) {
+        double v = ceil(m[c + l]);
+        counts[l][v < HIST_BINS - 1 ? (int)v : HIST_BINS - 1]++;
+      }
+    }
+    for (; c < cols - 1; c++) {
+      double v = ceil(m[c]);
+      counts[0][v < HIST_BINS - 1 ? (int)v : HIST_BINS - 1]++;
+    }
+  }
+
+  pthread_mutex_lock(&job->lock);
+  for (int l = 0; l < HIST_LANES; l++) {
+    for (int i = 0; i < HIST_BINS; i++) {
+      job->bins[i] += counts[l][i];
+    }
+  }
+  pthread_mutex_unlock(&job->lock);
+}
+
+unsigned long long gradient_histogram(unsigned long long bins[HIST_BINS], const double *mag,
+                                      int rows, int cols, ThreadPool *pool) {
+  memset(bins, 0, sizeof(unsigned long long) * HIST_BINS);
+  if (rows < 3 || cols < 3) {
+    return 0;
+  }
+  HistJob job = { .mag = mag, .cols = cols, .bins = bins };
+  pthread_mutex_init(&job.lock, NULL);
+  pool_run(pool, rows - 2, count_gradient_rows, &job);
+  pthread_mutex_destroy(&job.lock);
+  return (unsigned long long)(rows - 2) * (cols - 2);
+}
+
+int otsu_threshold(const unsigned long long bins[HIST_BINS]) {
+  double total = 0, sum = 0;
+  for (int i = 0; i < HIST_BINS; i++) {
+    total += bins[i];
+    sum += (double)i * bins[i];
+  }
+
+  // grow the lower class one bin at a time
+  double w0 = 0, sum0 = 0, best = -1;
+  int t = 0;
+  for (int i = 0; i < HIST_BINS; i++) {
+    w0 += bins[i];
+    sum0 += (double)i * bins[i];
+    double w1 = total - w0;
+    if (w0 == 0 || w1 == 0) {
+      continue;
+    }
+    double diff = sum0 / w0 - (sum - sum0) / w1;
+    double between = w0 * w1 * diff * diff;
+    if (between > best) {
+      best = between;
+      t = i;
+    }
+  }
+  return t;
+}
+
+int percentile_bin(const unsigned long long bins[HIST_BINS], double percent) {
+  unsigned long long total = 0;
+  for (int i = 0; i < HIST_BINS; i++) {
+    total += bins[i];
+  }
+
+  double target = total * percent / 100.0;
+  unsigned long long seen = 0;
+  for (int i = 0; i < HIST_BINS; i++) {
+    seen += bins[i];
+    if (seen > 0 && seen >= target) {
+      return i;
+    }
+  }
+  return HIST_BINS - 1;
+}
@@ -0,0 +1,43 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stddef.h>
+#include "thread_pool.h"
+
+/* Single-pass image histograms. Each thread counts its rows into
+ * private bins which are merged once at the end, so a pool adds no
+ * contention; a NULL pool counts on the calling thread.
+ */
+
+#define HIST_BINS 256
+
+/* per-channel and luma (NTSC grayscale) counts of an RGB image */
+typedef struct _histogram {
+  unsigned long long r[HIST_BINS];
+  unsigned long long g[HIST_BINS];
+  unsigned long long b[HIST_BINS];
+  unsigned long long luma[HIST_BINS];
+  unsigned long long total;
+} Histogram;
+
+
+/* count the pixels of a rows x cols RGB image with 3 bytes per
+ * pixel, row r starting at data + r * stride */
+void compute_histogram(Histogram *h, const unsigned char *data, int rows, int cols,
+                       ptrdiff_t stride, ThreadPool *pool);
+
+/* count the interior of a rows x cols gradient magnitude field (see
+ * gradient_magnitude); magnitude m goes in bin ceil(m), capped at 255,
+ * so "m > t" holds exactly for the bins above t. Returns the count */
+unsigned long long gradient_histogram(unsigned long long bins[HIST_BINS], const double *mag,
+                                      int rows, int cols, ThreadPool *pool);
+
+/* Otsu's threshold: the bin t maximizing the between-class variance
+ * of bins <= t and bins > t */
+int otsu_threshold(const unsigned long long bins[HIST_BINS]);
+
+/* smallest bin t with at least percent% of the counts in bins <= t */
+int percentile_bin(const unsigned long long bins[HIST_BINS], double percent);
+
+
+#endif
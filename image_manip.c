@@ -4,63 +4,85 @@
 #include <assert.h>
 #include "image_manip.h"
 #include "ppm_io.h"
+#include "histogram.h"
+#include "cbitphoto.h"
+
+/* The operations below are wrappers over libcbitphoto: each describes
+ * its Image as a CbpView and runs the library kernel on a
+ * single-threaded context (the sweep helpers can be handed a shared
+ * one instead), so ./project and the library share one implementation
+ * of every operation.
+ */
+
+/* HELPER for the wrappers:
+ * view of an image's pixels (Pixel is 3 packed bytes)
+ */
+static CbpView image_view(const Image *im) {
+  CbpView v = { (unsigned char *)im->data, im->rows, im->cols,
+                (ptrdiff_t)im->cols * (ptrdiff_t)sizeof(Pixel) };
+  return v;
+}
+
+/* HELPER for the wrappers:
+ * create a single-threaded context; NULL (after a message) on failure
+ */
+static CbpContext *op_context(const char *op) {
+  CbpContext *ctx;
+  if (cbp_context_create(&ctx, 1) != CBP_OK) {
+    fprintf(stderr, "Error:image_manip - %s could not create a context\n", op);
+    return NULL;
+  }
+  return ctx;
+}
 
-/* HELPER for grayscale:
- * convert a RGB pixel to a single grayscale intensity;
- * uses NTSC standard conversion
+/* HELPER for the wrappers:
+ * report a failed library call; return 1 if status is an error
  */
-unsigned char pixel_to_gray(const Pixel *p) {
-  return (unsigned char)( (0.3 * (double)p->r) +
-                          (0.59 * (double)p->g) +
-                          (0.11 * (double)p->b) );
+static int op_failed(int status, const char *op) {
+  if (status != CBP_OK) {
+    fprintf(stderr, "Error:image_manip - %s failed: %s\n", op, cbp_strerror(status));
+    return 1;
+  }
+  return 0;
 }
 
 /* ______grayscale______
  * convert an image to grayscale (NOTE: pixels are still
  * RGB, but the three values will be equal)
  */
-void grayscale(Image *im) {
+int grayscale(Image *im) {
   if (!im || !im->data) {
     fprintf(stderr, "Error:image_manip - grayscale given a bad image pointer\n");
-    return;
+    return -1;
   }
 
-  for (int r=0; r<im->rows; r++){
-    for (int c=0; c<im->cols; c++){
-      // find grayscale intensity
-      unsigned char grayLevel = pixel_to_gray(&(im->data[(r*im->cols)+c]));
-
-      // set all chanels to it
-      im->data[(r*im->cols)+c].r = grayLevel;
-      im->data[(r*im->cols)+c].g = grayLevel;
-      im->data[(r*im->cols)+c].b = grayLevel;
-
-    }
+  CbpContext *ctx = op_context("grayscale");
+  if (!ctx) {
+    return -1;
   }
+  CbpView v = image_view(im);
+  int failed = op_failed(cbp_grayscale(ctx, &v, &v), "grayscale");
+  cbp_context_destroy(ctx);
+  return failed ? -1 : 0;
 }
 
 /* ______swap______
  * swap color channels of an image
  */
-void swap(Image *im){
+int swap(Image *im){
   if (!im || !im->data) {
     fprintf(stderr, "Error:image_manip - swap given a bad image pointer\n");
-    return;
+    return -1;
   }
 
-  for (int r=0; r<im->rows; r++){
-    for (int c=0; c<im->cols; c++){
-      // create temp variables for rgb and effectively swap them  
-      Pixel curr = im->data[(r*(im->cols))+c];
-      unsigned char oldRed = curr.r;
-      unsigned char oldGreen= curr.g;
-      unsigned char oldBlue = curr.b;
-
-      im->data[(r*(im->cols))+c].r = oldGreen;
-      im->data[(r*(im->cols))+c].g = oldBlue;
-      im->data[(r*(im->cols))+c].b = oldRed;
-    }
+  CbpContext *ctx = op_context("swap");
+  if (!ctx) {
+    return -1;
   }
+  CbpView v = image_view(im);
+  int failed = op_failed(cbp_swap(ctx, &v, &v), "swap");
+  cbp_context_destroy(ctx);
+  return failed ? -1 : 0;
 }
  
 
@@ -68,22 +90,67 @@ void swap(Image *im){
  * invert the intensity of each channel
  */
 
- void invert(Image *im)
+ int invert(Image *im)
  {
     if (!im || !im->data) {
     fprintf(stderr, "Error:image_manip - invert given a bad image pointer\n");
+    return -1;
+  }
+
+  CbpContext *ctx = op_context("invert");
+  if (!ctx) {
+    return -1;
+  }
+  CbpView v = image_view(im);
+  int failed = op_failed(cbp_invert(ctx, &v, &v), "invert");
+  cbp_context_destroy(ctx);
+  return failed ? -1 : 0;
+ }
+
+/* ______auto-levels______
+ * stretch each channel so that its darkest 0.5% of pixels map to 0
+ * and its brightest 0.5% to 255, using one histogram pass
+ */
+void autolevels(Image *im, ThreadPool *pool) {
+  if (!im || !im->data) {
+    fprintf(stderr, "Error:image_manip - autolevels given a bad image pointer\n");
     return;
   }
 
+  Histogram h;
+  compute_histogram(&h, (unsigned char *)im->data, im->rows, im->cols,
+                    im->cols * sizeof(Pixel), pool);
+
+  // lookup table per channel; a flat channel is left alone
+  unsigned char lut[3][256];
+  const unsigned long long *bins[3] = {h.r, h.g, h.b};
+  for (int k = 0; k < 3; k++) {
+    int low = percentile_bin(bins[k], 0.5);
+    int high = percentile_bin(bins[k], 99.5);
+    for (int v = 0; v < 256; v++) {
+      if (high <= low) {
+        lut[k][v] = v;
+      }
+      else if (v <= low) {
+        lut[k][v] = 0;
+      }
+      else if (v >= high) {
+        lut[k][v] = 255;
+      }
+      else {
+        lut[k][v] = (unsigned char)(((v - low) * 255 + (high - low) / 2) / (high - low));
+      }
+    }
+  }
+
   for (int r=0; r<im->rows; r++){
     for (int c=0; c<im->cols; c++){
-      // set to inverse
-      im->data[(r*im->cols)+c].r = 255 - im->data[(r*im->cols)+c].r;
-      im->data[(r*im->cols)+c].g = 255 - im->data[(r*im->cols)+c].g;
-      im->data[(r*im->cols)+c].b = 255 - im->data[(r*im->cols)+c].b;
+      im->data[(r*im->cols)+c].r = lut[0][im->data[(r*im->cols)+c].r];
+      im->data[(r*im->cols)+c].g = lut[1][im->data[(r*im->cols)+c].g];
+      im->data[(r*im->cols)+c].b = lut[2][im->data[(r*im->cols)+c].b];
     }
   }
- }
+}
 
 /* ______zoom_out______
  * "zoom out" an image, by taking a 2x2 square of pixels and averaging
@@ -95,59 +162,70 @@ void swap(Image *im){
 Image *zoomout(Image *im){
   if (!im || !im->data) {
     fprintf(stderr, "Error:image_manip - zoomout given a bad image pointer\n");
-    return im;
+    return NULL;
   }
 
-  // calculate space to properly allocate
+  // allocate space for new image
   // if odd # of rows or cols, the last row/col will be disregarded
-  // ex: 13 rows / 2 = 6 rows
-  int rows = im->rows / 2;
-  int cols = im->cols / 2;
+  Image *newIm = make_image(im->rows / 2, im->cols / 2);
+  CbpContext *ctx = op_context("zoomout");
+  if (!newIm || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate zoomout image\n");
+    if (newIm) {
+      free_image(&newIm);
+    }
+    cbp_context_destroy(ctx);
+    return NULL;
+  }
 
-  // allocate space for new image
-  Image *newIm = malloc(sizeof(Image));
-  newIm->rows=rows;
-  newIm->cols=cols;
-  newIm->data = malloc(sizeof(Pixel) * rows * cols);
-
-  // traverse through 2x2 pixels and create new pixel
-  // elimate odd row and column
-  if(im->rows % 2 != 0){
-    im->rows= (im->rows)-1;
-  }
-   if(im->cols % 2 != 0){
-    im->cols = (im->cols)-1;
-  }
-
-  // counter for the index of the 2x2 pixel
-  int count=0;
-  for(int r=0;r<im->rows;r++){
-    for(int c=0;c<im->cols;c++){
-      unsigned char red = im->data[(r*im->cols)+c].r;
-      unsigned char red2 = im->data[(r*im->cols)+c+1].r;
-      unsigned char red3 = im->data[((r+1)*im->cols)+c].r;
-      unsigned char red4 = im->data[((r+1)*im->cols)+c+1].r;
-
-      unsigned char green = im->data[(r*im->cols)+c].g;
-      unsigned char green2 = im->data[(r*im->cols)+c+1].g;
-      unsigned char green3 = im->data[((r+1)*im->cols)+c].g;
-      unsigned char green4 = im->data[((r+1)*im->cols)+c+1].g;
-
-      unsigned char blue = im->data[(r*im->cols)+c].b;
-      unsigned char blue2 = im->data[(r*im->cols)+c+1].b;
-      unsigned char blue3 = im->data[((r+1)*im->cols)+c].b;
-      unsigned char blue4 = im->data[((r+1)*im->cols)+c+1].b;
-
-      // average values
-      newIm->data[count].r=(red+red2+red3+red4)/4;
-      newIm->data[count].g=(green+green2+green3+green4)/4;
-      newIm->data[count].b=(blue+blue2+blue3+blue4)/4;
-      count+=1;
-
-      // increment to skip an additional column
-      c+=1;
+  CbpView src = image_view(im);
+  CbpView dst = image_view(newIm);
+  int failed = op_failed(cbp_zoomout(ctx, &src, &dst), "zoomout");
+  cbp_context_destroy(ctx);
+  if (failed) {
+    free_image(&newIm);
+    return NULL;
+  }
+
+  // free original image before returning new one
+  free_image(&im);
+  return newIm;
+}
+
+/* ______zoom_out_n______
+ * "zoom out" an image by an integer factor n, averaging each n x n
+ * block of pixels into one using a summed-area table, so the cost per
+ * output pixel does not grow with n. Leftover rows and columns at the
+ * bottom and right are dropped, as in zoomout.
+ */
+Image *zoomout_n(Image *im, int n){
+  if (!im || !im->data) {
+    fprintf(stderr, "Error:image_manip - zoomout_n given a bad image pointer\n");
+    return NULL;
+  }
+  if (n < 1 || n > im->rows || n > im->cols) {
+    fprintf(stderr, "Error:image_manip - zoomout_n given a factor larger than the image\n");
+    return NULL;
+  }
+
+  Image *newIm = make_image(im->rows / n, im->cols / n);
+  CbpContext *ctx = op_context("zoomout_n");
+  if (!newIm || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate zoomout_n image\n");
+    if (newIm) {
+      free_image(&newIm);
     }
-    r+=1;
+    cbp_context_destroy(ctx);
+    return NULL;
+  }
+
+  CbpView src = image_view(im);
+  CbpView dst = image_view(newIm);
+  int failed = op_failed(cbp_downscale(ctx, &src, &dst, n), "zoomout_n");
+  cbp_context_destroy(ctx);
+  if (failed) {
+    free_image(&newIm);
+    return NULL;
   }
 
   // free original image before returning new one
@@ -155,6 +233,32 @@ Image *zoomout(Image *im){
   return newIm;
 }
 
+/* ______blur______
+ * box blur: replace each pixel with the average of the square of
+ * pixels within radius of it (clipped at the edges); uses a
+ * summed-area table so the cost does not depend on the radius
+ */
+Image *blur(Image *im, int radius){
+  if (!im || !im->data) {
+    fprintf(stderr, "Error:image_manip - blur given a bad image pointer\n");
+    return NULL;
+  }
+  if (radius < 0) {
+    fprintf(stderr, "Error:image_manip - blur given a negative radius\n");
+    return NULL;
+  }
+
+  CbpContext *ctx = op_context("blur");
+  if (!ctx) {
+    return NULL;
+  }
+  // the table holds everything needed, so blur in place
+  CbpView v = image_view(im);
+  int failed = op_failed(cbp_box_blur(ctx, &v, &v, radius), "blur");
+  cbp_context_destroy(ctx);
+  return failed ? NULL : im;
+}
+
 /* _______rotate-right________
  * rotate the input image clockwise 90 degrees
  */
@@ -162,29 +266,30 @@ Image *zoomout(Image *im){
 Image *rotateright(Image *im){
   if (!im || !im->data) {
     fprintf(stderr, "Error:image_manip - rotateright given a bad image pointer\n");
-    return im;
-  }
-
-  // realloc approporiate space
-  int rows = im->rows;
-  int cols = im-> cols;
-  Image *newIm = malloc(sizeof(Image));
-  newIm->rows=cols;
-  newIm->cols=rows;
-  newIm->data = malloc(sizeof(Pixel) * rows * cols);
-
-  // transposing a right-rotated version of our image to our new image
-  // reverse first column of old = first row of new
-  int count=0;
-  for (int c = 0; c < cols; c++){
-    for (int r = rows-1; r>=0; r--) {
-      // assign new pixels
-      newIm->data[count].r = im->data[(r*im->cols)+c].r;
-      newIm->data[count].g = im->data[(r*im->cols)+c].g;
-      newIm->data[count].b = im->data[(r*im->cols)+c].b;
-      count+=1;
+    return NULL;
+  }
+
+  // the new image swaps rows and columns
+  Image *newIm = make_image(im->cols, im->rows);
+  CbpContext *ctx = op_context("rotateright");
+  if (!newIm || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate rotateright image\n");
+    if (newIm) {
+      free_image(&newIm);
     }
+    cbp_context_destroy(ctx);
+    return NULL;
+  }
+
+  CbpView src = image_view(im);
+  CbpView dst = image_view(newIm);
+  int failed = op_failed(cbp_rotateright(ctx, &src, &dst), "rotateright");
+  cbp_context_destroy(ctx);
+  if (failed) {
+    free_image(&newIm);
+    return NULL;
   }
+
   //freeing original image
   free_image(&im);
   //returning new image
@@ -193,6 +298,70 @@ Image *rotateright(Image *im){
 
 
 
+/* ______radius_map______
+ * compute the distance of every pixel from the swirl center;
+ * this does not depend on the strength, so a sweep over strengths
+ * can compute it once and reuse it
+ */
+double *radius_map(const Image *im, double cx, double cy, CbpContext *ctx) {
+  if (!im || !im->data) {
+    fprintf(stderr, "Error:image_manip - radius_map given a bad image pointer\n");
+    return NULL;
+  }
+
+  double *radius = malloc(sizeof(double) * im->rows * im->cols);
+  CbpContext *own = ctx ? NULL : (ctx = op_context("radius_map"));
+  if (!radius || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate radius map\n");
+    free(radius);
+    cbp_context_destroy(own);
+    return NULL;
+  }
+
+  int failed = op_failed(cbp_radius_map(ctx, im->rows, im->cols, cx, cy, radius), "radius_map");
+  cbp_context_destroy(own);
+  if (failed) {
+    free(radius);
+    return NULL;
+  }
+  return radius;
+}
+
+/* ______swirl_from_radius______
+ * resample the image into a new swirled image of strength s,
+ * using a radius map from radius_map() for the same center;
+ * the input image is left untouched
+ */
+Image *swirl_from_radius(const Image *im, const double *radius, double cx, double cy, double s,
+                         CbpContext *ctx) {
+  if (!im || !im->data || !radius) {
+    fprintf(stderr, "Error:image_manip - swirl_from_radius given a bad pointer\n");
+    return NULL;
+  }
+
+  Image *newIm = make_image(im->rows, im->cols);
+  CbpContext *own = ctx ? NULL : (ctx = op_context("swirl_from_radius"));
+  if (!newIm || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate swirl image\n");
+    if (newIm) {
+      free_image(&newIm);
+    }
+    cbp_context_destroy(own);
+    return NULL;
+  }
+
+  CbpView src = image_view(im);
+  CbpView dst = image_view(newIm);
+  int failed = op_failed(cbp_swirl_from_radius(ctx, &src, &dst, radius, cx, cy, s),
+                         "swirl_from_radius");
+  cbp_context_destroy(own);
+  if (failed) {
+    free_image(&newIm);
+    return NULL;
+  }
+  return newIm;
+}
+
 /* ________Swirl effect_________
  * Create a whirlpool effect!
  */
@@ -201,55 +370,106 @@ Image *rotateright(Image *im){
 Image *swirl(Image *im, double cx, double cy, double s) {
   if (!im || !im->data) {
     fprintf(stderr, "Error:image_manip - swirl given a bad image pointer\n");
-    return im;
+    return NULL;
   }
 
-  if(cx<-1 || cy<-1 || s<0){
-    fprintf(stderr, "Error:image_manip - swirl given a negative center coordinates or a negative scale\n");
-    return im;
+  if(cx<-1 || cy<-1 || s<=0){
+    fprintf(stderr, "Error:image_manip - swirl given a negative center coordinates or a non-positive scale\n");
+    return NULL;
   }
 
-  // allocate new image
-  Image *newIm=malloc(sizeof(Image));
-  newIm->cols=im->cols;
-  newIm->rows=im->rows;
-  newIm->data=malloc(sizeof(Pixel)*im->rows*im->cols);
+  Image *newIm = make_image(im->rows, im->cols);
+  CbpContext *ctx = op_context("swirl");
+  if (!newIm || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate swirl image\n");
+    if (newIm) {
+      free_image(&newIm);
+    }
+    cbp_context_destroy(ctx);
+    return NULL;
+  }
 
   // perform swirl
-  // if conditions for -1 special condition
-  if(cx==-1){
-    cx = im->cols/2.0;
-  }
-  if(cy==-1){
-    cy = im->rows/2.0;
-  }
-
-  for(int r=0;r<im->rows;r++){
-    for(int c=0;c<im->cols;c++){
-      double a = (sqrt((c-cx)*(c-cx)+(r-cy)*(r-cy)))/s;
-
-      // the coordinates for the swirl image
-      int sC = (c-cx)*cos(a)-(r-cy)*sin(a)+cx;
-      int sR = (c-cx)*sin(a)+(r-cy)*cos(a)+cy;
-      
-      // if pixel is not outside the range, add approporiate pixel
-      if(!(sR>im->rows-1 || sC>im->cols-1 || sC<0 || sR<0)){
-        newIm->data[(r*im->cols)+c].r = im->data[(sR*im->cols)+sC].r;
-        newIm->data[(r*im->cols)+c].g = im->data[(sR*im->cols)+sC].g;
-        newIm->data[(r*im->cols)+c].b = im->data[(sR*im->cols)+sC].b;
-      }
-      else{
-        newIm->data[(r*im->cols)+c].r=0;
-        newIm->data[(r*im->cols)+c].g=0;
-        newIm->data[(r*im->cols)+c].b=0;
-      }
-    }
+  CbpView src = image_view(im);
+  CbpView dst = image_view(newIm);
+  int failed = op_failed(cbp_swirl(ctx, &src, &dst, cx, cy, s), "swirl");
+  cbp_context_destroy(ctx);
+  if (failed) {
+    free_image(&newIm);
+    return NULL;
   }
 
   free_image(&im);
   return newIm;
 }
 
+/* ______gradient_magnitude______
+ * convert the image to grayscale (in place) and compute the
+ * intensity gradient magnitude of every interior pixel; boundary
+ * entries are left at 0. The result does not depend on the
+ * threshold, so a sweep over thresholds can compute it once
+ */
+double *gradient_magnitude(Image *im, CbpContext *ctx) {
+  if (!im || !im->data) {
+    fprintf(stderr, "Error:image_manip - gradient_magnitude given a bad image pointer\n");
+    return NULL;
+  }
+
+  double *mag = malloc(sizeof(double) * im->rows * im->cols);
+  CbpContext *own = ctx ? NULL : (ctx = op_context("gradient_magnitude"));
+  if (!mag || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate gradient field\n");
+    free(mag);
+    cbp_context_destroy(own);
+    return NULL;
+  }
+
+  CbpView v = image_view(im);
+  int failed = op_failed(cbp_grayscale(ctx, &v, &v), "gradient_magnitude") ||
+               op_failed(cbp_gradient_magnitude(ctx, &v, mag), "gradient_magnitude");
+  cbp_context_destroy(own);
+  if (failed) {
+    free(mag);
+    return NULL;
+  }
+  return mag;
+}
+
+/* ______threshold_edges______
+ * build an edge image from a grayscale image and its gradient
+ * magnitudes (see gradient_magnitude); interior pixels above the
+ * threshold become black, the rest white, and the boundary keeps
+ * the grayscale values. The inputs are left untouched
+ */
+Image *threshold_edges(const Image *gray, const double *mag, int threshold, CbpContext *ctx) {
+  if (!gray || !gray->data || !mag) {
+    fprintf(stderr, "Error:image_manip - threshold_edges given a bad pointer\n");
+    return NULL;
+  }
+
+  Image *newIm = make_image(gray->rows, gray->cols);
+  CbpContext *own = ctx ? NULL : (ctx = op_context("threshold_edges"));
+  if (!newIm || !ctx) {
+    fprintf(stderr, "Error:image_manip - failed to allocate edge image\n");
+    if (newIm) {
+      free_image(&newIm);
+    }
+    cbp_context_destroy(own);
+    return NULL;
+  }
+
+  CbpView src = image_view(gray);
+  CbpView dst = image_view(newIm);
+  int failed = op_failed(cbp_threshold_edges(ctx, &src, mag, &dst, threshold),
+                         "threshold_edges");
+  cbp_context_destroy(own);
+  if (failed) {
+    free_image(&newIm);
+    return NULL;
+  }
+  return newIm;
+}
+
 /* _______edges________
  * apply edge detection as a grayscale conversion
  * followed by an intensity gradient computation and
@@ -258,53 +478,53 @@ Image *swirl(Image *im, double cx, double cy, double s) {
 Image *edgeDetection(Image *im, int threshold) {
   if (!im || !im->data) {
     fprintf(stderr, "Error:image_manip - edge_detection given a bad image pointer\n");
-    return im;
-  }
-  grayscale(im);
-  Image* newIm = make_image(im->rows, im->cols);
-
-  for(int c=1;c<im->cols-1;c++){
-    for(int r=1;r<im->rows-1;r++){
-      double x = 1.0 * (im->data[(r*im->cols)+c+1].r - im->data[(r*im->cols)+c-1].r)/2;
-      double y = 1.0 * (im->data[((r+1)*im->cols)+c].r - im->data[((r-1)*im->cols)+c].r)/2;
-      double magnitude = sqrt(x*x+y*y);
-      
-      if (magnitude > threshold) {
-        newIm->data[(r*im->cols)+c].r = 0;
-        newIm->data[(r*im->cols)+c].g = 0;
-        newIm->data[(r*im->cols)+c].b = 0;
-      }
-      else {
-        newIm->data[(r*im->cols)+c].r = 255;
-        newIm->data[(r*im->cols)+c].g = 255;
-        newIm->data[(r*im->cols)+c].b = 255;
-      }
-    }
+    return NULL;
   }
 
-  // manually set boundaries to avoid memory errors
-  for(int i=0;i<im->cols;i++){
-    newIm->data[i].r = im->data[i].r;
-    newIm->data[i].g = im->data[i].g;
-    newIm->data[i].b = im->data[i].b;
+  double *mag = gradient_magnitude(im, NULL);
+  if (!mag) {
+    return NULL;
   }
-  for(int i=0;i<im->cols;i++){
-    newIm->data[(im->rows-1)*im->cols+i].r = im->data[(im->rows-1)*im->cols+i].r;
-    newIm->data[(im->rows-1)*im->cols+i].g = im->data[(im->rows-1)*im->cols+i].g;
-    newIm->data[(im->rows-1)*im->cols+i].b = im->data[(im->rows-1)*im->cols+i].b;
+  Image *newIm = threshold_edges(im, mag, threshold, NULL);
+  free(mag);
+  if (!newIm) {
+    return NULL;
   }
-  for(int i=0;i<im->rows;i++){
-    newIm->data[i*(im->cols)].r = im->data[i*(im->cols)].r;
-    newIm->data[i*(im->cols)].g = im->data[i*(im->cols)].g;
-    newIm->data[i*(im->cols)].b = im->data[i*(im->cols)].b;
+
+  free_image(&im);
+  return newIm;
+}
+
+/* _______edges auto________
+ * edge detection with the threshold picked from the histogram of
+ * gradient magnitudes: Otsu's method if percent < 0, otherwise the
+ * given percentile (so about (100 - percent)% of pixels become edges).
+ * The chosen threshold is stored in *threshold, or -1 on failure
+ * (then NULL is returned and im is left to the caller)
+ */
+Image *edgeDetectionAuto(Image *im, double percent, ThreadPool *pool, int *threshold) {
+  *threshold = -1;
+  if (!im || !im->data) {
+    fprintf(stderr, "Error:image_manip - edge_detection given a bad image pointer\n");
+    return NULL;
   }
-  for(int i=0;i<im->rows;i++){
-    newIm->data[i*(im->cols)+(im->cols-1)].r = im->data[i*(im->cols)+(im->cols-1)].r;
-    newIm->data[i*(im->cols)+(im->cols-1)].g = im->data[i*(im->cols)+(im->cols-1)].g;
-    newIm->data[i*(im->cols)+(im->cols-1)].b = im->data[i*(im->cols)+(im->cols-1)].b;
+
+  double *mag = gradient_magnitude(im, NULL);
+  if (!mag) {
+    return NULL;
+  }
+
+  unsigned long long bins[HIST_BINS];
+  gradient_histogram(bins, mag, im->rows, im->cols, pool);
+  int t = percent < 0 ? otsu_threshold(bins) : percentile_bin(bins, percent);
+
+  Image *newIm = threshold_edges(im, mag, t, NULL);
+  free(mag);
+  if (!newIm) {
+    return NULL;
   }
+  *threshold = t;
 
   free_image(&im);
   return newIm;
 }
- 
\ No newline at end of file
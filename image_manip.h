@@ -2,6 +2,8 @@
 #define IMAGE_MANIP_H
 
 #include "ppm_io.h"
+#include "thread_pool.h"
+#include "cbitphoto.h"
 
 // store PI as a constant
 #define PI 3.14159265358979323846
@@ -13,41 +15,104 @@
 #define MAX(a,b) ((a > b) ? (a) : (b))
 
 /* ______swap______
- * swap color channels of an image
+ * swap color channels of an image;
+ * returns 0 on success, -1 on failure
  */
-void swap(Image *im);
+int swap(Image *im);
 
 /* ______invert______
- * invert the intensity of each channel
+ * invert the intensity of each channel;
+ * returns 0 on success, -1 on failure
  */
-void invert(Image *im);
+int invert(Image *im);
+
+/* ______auto-levels______
+ * stretch each channel between its 0.5th and 99.5th percentiles;
+ * the histogram is counted on pool's threads (pool may be NULL)
+ */
+void autolevels(Image *im, ThreadPool *pool);
 
 /* ______zoom_out______
  * "zoom out" an image, by taking a 2x2 square of pixels and averaging
  * each of the three color channels to make a single pixel. If an odd
  * number of rows in original image, we lose info about the bottom row.
  * If an odd number of columns in original image, we lose info about the
- * rightmost column.
+ * rightmost column. Returns NULL on failure, leaving im to the caller.
  */
 Image *zoomout(Image *im);
 
+/* ______zoom_out_n______
+ * "zoom out" by any integer factor n, averaging each n x n block;
+ * constant cost per pixel regardless of n. Returns NULL on failure,
+ * leaving im to the caller.
+ */
+Image *zoomout_n(Image *im, int n);
+
+/* ______blur______
+ * box blur with the given radius (0 leaves the image unchanged);
+ * constant cost per pixel regardless of radius. Returns NULL on
+ * failure.
+ */
+Image *blur(Image *im, int radius);
+
 /* _______rotate-right________
- * rotate the input image clockwise 90 degrees
+ * rotate the input image clockwise 90 degrees;
+ * returns NULL on failure, leaving im to the caller
  */
 Image *rotateright(Image *im);
 
 /* ________Swirl effect_________
- * Create a whirlpool effect!
+ * Create a whirlpool effect! Returns NULL on failure,
+ * leaving im to the caller.
  */
  Image *swirl(Image *im, double cx, double cy, double s);
 
+/* ______radius_map______
+ * compute the distance of every pixel from the swirl center
+ * (cx/cy of -1 mean the middle of the image); caller frees.
+ * Runs on ctx, or on a single-threaded context of its own if ctx
+ * is NULL. Returns NULL on failure.
+ */
+double *radius_map(const Image *im, double cx, double cy, CbpContext *ctx);
+
+/* ______swirl_from_radius______
+ * swirl with strength s using a precomputed radius map, so that
+ * several strengths can share one map; returns a new image and
+ * leaves the input alone. ctx as for radius_map. Returns NULL on
+ * failure.
+ */
+Image *swirl_from_radius(const Image *im, const double *radius, double cx, double cy, double s,
+                         CbpContext *ctx);
+
 
 /* _______edges________
  * apply edge detection as a grayscale conversion
  * followed by an intensity gradient computation and
- * thresholding
+ * thresholding. Returns NULL on failure, leaving im to the caller.
  */
 Image *edgeDetection(Image *im, int threshold);
 
+/* ______gradient_magnitude______
+ * convert the image to grayscale in place and return its gradient
+ * magnitude field (rows*cols, boundary entries 0); caller frees.
+ * ctx as for radius_map. Returns NULL on failure.
+ */
+double *gradient_magnitude(Image *im, CbpContext *ctx);
+
+/* ______threshold_edges______
+ * threshold a gradient field from gradient_magnitude into a new
+ * edge image; leaves the inputs alone. ctx as for radius_map.
+ * Returns NULL on failure.
+ */
+Image *threshold_edges(const Image *gray, const double *mag, int threshold, CbpContext *ctx);
+
+/* _______edges auto________
+ * edge detection with an automatic threshold from the gradient
+ * histogram: Otsu's method for percent < 0, otherwise the given
+ * percentile of gradient magnitudes. Stores the threshold used;
+ * on failure stores -1 and returns NULL, leaving im to the caller
+ */
+Image *edgeDetectionAuto(Image *im, double percent, ThreadPool *pool, int *threshold);
+
 
 #endif
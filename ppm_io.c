@@ -35,50 +35,71 @@ int read_num(FILE *fp) {
 
 
 
-Image * read_ppm(FILE *fp) {
+/* read the P6 header up to the first pixel byte, storing the
+ * image size; return -1 if it is not a valid PPM, otherwise 0
+ */
+int read_ppm_header(FILE *fp, int *rows, int *cols) {
 
   /* confirm that we received a good file handle */
   assert(fp != NULL);
 
-  /* allocate image (but not space to hold pixels -- yet) */
-  Image *im = malloc(sizeof(Image));
-  if (!im) {
-    fprintf(stderr, "Error:ppm_io - failed to allocate memory for image!\n");
-    return NULL;
-  }
-
-  /* initialize fields to error codes, in case we have to bail out early */
-  im->rows = im->cols = -1;
-
   /* read in tag; fail if not P6 */
   char tag[20];
   tag[19]='\0';
   fscanf(fp, "%19s\n", tag);
   if (strncmp(tag, "P6", 20)) {
     fprintf(stderr, "Error:ppm_io - not a PPM (bad tag)\n");
-    free(im);
-    return NULL;
+    return -1;
   }
 
 
   /* read image dimensions */
  
   //read in columns
-  im->cols = read_num(fp); // NOTE: cols, then rows (i.e. X size followed by Y size)
+  *cols = read_num(fp); // NOTE: cols, then rows (i.e. X size followed by Y size)
   //read in rows
-  im->rows = read_num(fp);
+  *rows = read_num(fp);
 
   //read in colors; fail if not 255
   int colors = read_num(fp);
   if (colors != 255) {
     fprintf(stderr, "Error:ppm_io - PPM file with colors different from 255\n");
-    free(im);
-    return NULL;
+    return -1;
   }
 
   //confirm that dimensions are positive
-  if (im->cols <= 0 || im->rows <= 0) {
+  if (*cols <= 0 || *rows <= 0) {
     fprintf(stderr, "Error:ppm_io - PPM file with non-positive dimensions\n");
+    return -1;
+  }
+  return 0;
+}
+
+/* write the P6 header for an image of the given size */
+void write_ppm_header(FILE *fp, int rows, int cols) {
+  fprintf(fp, "P6\n");
+  fprintf(fp, "%d %d\n", cols, rows);
+  int color = 255;
+  fprintf(fp, "%d\n", color);
+}
+
+Image * read_ppm(FILE *fp) {
+
+  /* confirm that we received a good file handle */
+  assert(fp != NULL);
+
+  /* allocate image (but not space to hold pixels -- yet) */
+  Image *im = malloc(sizeof(Image));
+  if (!im) {
+    fprintf(stderr, "Error:ppm_io - failed to allocate memory for image!\n");
+    return NULL;
+  }
+
+  /* initialize fields to error codes, in case we have to bail out early */
+  im->rows = im->cols = -1;
+
+  /* read the header; fail if not a 255-color P6 */
+  if (read_ppm_header(fp, &im->rows, &im->cols)) {
     free(im);
     return NULL;
   }
@@ -122,10 +143,7 @@ int write_ppm(FILE *fp, const Image *im) {
   int rows = im->rows;
  
   // write the necessary PPM headings
-  fprintf(fp, "P6\n");
-  fprintf(fp, "%d %d\n", cols, rows);
-  int color = 255;
-  fprintf(fp, "%d\n", color);
+  write_ppm_header(fp, rows, cols);
 
   if(fwrite(im->data, sizeof(Pixel), cols * rows, fp) != (size_t)((im->rows) * (im->cols))) {
     printf("Error in writing file\n");
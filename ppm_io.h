@@ -29,6 +29,15 @@ typedef struct _image {
 Image * read_ppm(FILE *fp);
 
 
+/* read just the P6 header, leaving fp at the first pixel;
+ * return -1 if it is not a valid PPM, otherwise 0 */
+int read_ppm_header(FILE *fp, int *rows, int *cols);
+
+
+/* write a P6 header for a rows x cols image */
+void write_ppm_header(FILE *fp, int rows, int cols);
+
+
 /* Write given image to disk as a PPM.
  * Return -1 if any failure occurs, otherwise return the number of pixels written.
  */
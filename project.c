@@ -3,8 +3,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <math.h>
 #include "ppm_io.h"
+#include "qoi_io.h"
 #include "image_manip.h"
+#include "rotate_ooc.h"
 
 // Return (exit) codes
 // TODO implement all these errors
@@ -19,6 +25,15 @@
 #define RC_UNSPECIFIED_ERR    8
 
 void print_usage();
+int parse_sweep(const char *arg, int *start, int *stop, int *step);
+int sweep_filename(const char *out, int value, char *buf, size_t size);
+int is_qoi(const char *filename);
+int write_output(const char *filename, const Image *im);
+int parse_auto(const char *arg, double *percent);
+int parse_size(const char *arg, size_t *size);
+int rotate_out_of_core(const char *in, const char *out, const char *budget);
+int sweep_swirl(Image *im, const char *out, double cx, double cy, int start, int stop, int step);
+int sweep_edges(Image *im, const char *out, int start, int stop, int step);
 
 int main(int argc, char* argv[]) {
 
@@ -29,19 +44,23 @@ int main(int argc, char* argv[]) {
     return RC_MISSING_FILENAME;
   }
 
+  // out-of-core rotation streams the files instead of loading the image
+  if(argc == 5 && !strcmp(argv[3], "rotate-right")){
+    return rotate_out_of_core(argv[1], argv[2], argv[4]);
+  }
+
   // Read in PPM file
   FILE *input = fopen(argv[1], "r");
   if(input==NULL){
     printf("Error: File open has failed; PPM is empty\n");
-    fclose(input);
     return RC_OPEN_FAILED;
   }
-  Image *im = read_ppm(input);
+  // format is chosen by extension: .qoi, otherwise PPM
+  Image *im = is_qoi(argv[1]) ? read_qoi(input) : read_ppm(input);
   fclose(input);
 
   if(im==NULL){
-    printf("Error: Given PPM file is invalid\n");
-    free_image(&im);
+    printf("Error: Given %s file is invalid\n", is_qoi(argv[1]) ? "QOI" : "PPM");
     return RC_INVALID_PPM;
   }
 
@@ -51,7 +70,8 @@ int main(int argc, char* argv[]) {
     return RC_INVALID_OPERATION;
   }
 
-  // apply approporiate function
+  // apply approporiate function; result stays NULL if it fails
+  Image *result = NULL;
   if(!strcmp(argv[3], "swap")){    
     // if more than 4 arguments; main file, input image, result image, and operation = 4
     if(argc != 4){
@@ -59,7 +79,7 @@ int main(int argc, char* argv[]) {
       free_image(&im);
       return RC_INVALID_OP_ARGS;
     }
-    swap(im);
+    result = swap(im) ? NULL : im;
   }
   else if(!strcmp(argv[3], "invert")){
     if(argc != 4){
@@ -67,15 +87,32 @@ int main(int argc, char* argv[]) {
       free_image(&im);
       return RC_INVALID_OP_ARGS;
     }
-    invert(im);
+    result = invert(im) ? NULL : im;
   } 
   else if(!strcmp(argv[3], "zoom-out")){
-    if(argc != 4){
+    if(argc != 4 && argc != 5){
       printf("Error: Incorrect amount of parameters for the requested function\n");
       free_image(&im);
       return RC_INVALID_OP_ARGS;
     }
-    im = zoomout(im);
+    if(argc == 4){
+      if(im->rows < 2 || im->cols < 2){
+        printf("Error: Incorrect range for the parameters of zoom-out function");
+        free_image(&im);
+        return RC_OP_ARGS_RANGE_ERR;
+      }
+      result = zoomout(im);
+    }
+    else{
+      // optional factor: average n x n blocks instead of 2x2
+      int n = atoi(argv[4]);
+      if(n < 1 || n > im->rows || n > im->cols){
+        printf("Error: Incorrect range for the parameters of zoom-out function");
+        free_image(&im);
+        return RC_OP_ARGS_RANGE_ERR;
+      }
+      result = zoomout_n(im, n);
+    }
   } 
   else if(!strcmp(argv[3], "rotate-right")){
     if(argc != 4){
@@ -83,7 +120,7 @@ int main(int argc, char* argv[]) {
       free_image(&im);
       return RC_INVALID_OP_ARGS;
     }
-    im = rotateright(im);
+    result = rotateright(im);
   } 
   // fully implement swirl and edge-detection
   else if(!strcmp(argv[3], "swirl")){
@@ -92,12 +129,24 @@ int main(int argc, char* argv[]) {
       free_image(&im);
       return RC_INVALID_OP_ARGS;
     }
-    if(atoi(argv[4]) < -1 || atoi(argv[5]) < -1 || atoi(argv[6]) < 0){
+    int start, stop, step;
+    if(parse_sweep(argv[6], &start, &stop, &step)){
+      // strength sweep: one output per strength, sharing the radius map
+      if(atoi(argv[4]) < -1 || atoi(argv[5]) < -1 || start <= 0 || stop < start || step <= 0){
+        printf("Error: Incorrect range for the parameters of swirl function");
+        free_image(&im);
+        return RC_OP_ARGS_RANGE_ERR;
+      }
+      int rc = sweep_swirl(im, argv[2], atoi(argv[4]), atoi(argv[5]), start, stop, step);
+      free_image(&im);
+      return rc;
+    }
+    if(atoi(argv[4]) < -1 || atoi(argv[5]) < -1 || atoi(argv[6]) <= 0){
       printf("Error: Incorrect range for the parameters of swirl function");
       free_image(&im);
       return RC_OP_ARGS_RANGE_ERR;
     }
-    im = swirl(im, atoi(argv[4]), atoi(argv[5]), atoi(argv[6]));
+    result = swirl(im, atoi(argv[4]), atoi(argv[5]), atoi(argv[6]));
   } 
   else if(!strcmp(argv[3], "edge-detection")){
     if(argc != 5){
@@ -105,12 +154,67 @@ int main(int argc, char* argv[]) {
       free_image(&im);
       return RC_INVALID_OP_ARGS;
     }
-    if(atoi(argv[4]) < 0){
+    int start, stop, step;
+    double percent;
+    int is_auto = parse_auto(argv[4], &percent);
+    if(is_auto < 0){
       printf("Error: Incorrect range for the parameters of edge function");
       free_image(&im);
       return RC_OP_ARGS_RANGE_ERR;
     }
-    im = edgeDetection(im, atoi(argv[4]));
+    if(is_auto){
+      // threshold picked from the gradient histogram
+      ThreadPool *pool = make_pool(0);
+      int threshold;
+      result = edgeDetectionAuto(im, percent, pool, &threshold);
+      free_pool(&pool);
+      if(result){
+        printf("Selected threshold: %d\n", threshold);
+      }
+    }
+    else if(parse_sweep(argv[4], &start, &stop, &step)){
+      // threshold sweep: one output per threshold, sharing the gradients
+      if(start < 0 || stop < start || step <= 0){
+        printf("Error: Incorrect range for the parameters of edge function");
+        free_image(&im);
+        return RC_OP_ARGS_RANGE_ERR;
+      }
+      int rc = sweep_edges(im, argv[2], start, stop, step);
+      free_image(&im);
+      return rc;
+    }
+    else{
+      if(atoi(argv[4]) < 0){
+        printf("Error: Incorrect range for the parameters of edge function");
+        free_image(&im);
+        return RC_OP_ARGS_RANGE_ERR;
+      }
+      result = edgeDetection(im, atoi(argv[4]));
+    }
+  }
+  else if(!strcmp(argv[3], "auto-levels")){
+    if(argc != 4){
+      printf("Error: Incorrect amount of parameters for the requested function\n");
+      free_image(&im);
+      return RC_INVALID_OP_ARGS;
+    }
+    ThreadPool *pool = make_pool(0);
+    autolevels(im, pool);
+    free_pool(&pool);
+    result = im;
+  }
+  else if(!strcmp(argv[3], "blur")){
+    if(argc != 5){
+      printf("Error: Incorrect amount of parameters for the requested function\n");
+      free_image(&im);
+      return RC_INVALID_OP_ARGS;
+    }
+    if(atoi(argv[4]) < 0){
+      printf("Error: Incorrect range for the parameters of blur function");
+      free_image(&im);
+      return RC_OP_ARGS_RANGE_ERR;
+    }
+    result = blur(im, atoi(argv[4]));
   }
   else{
     printf("Error: Given function is not listed or output file not specified\n");
@@ -118,30 +222,263 @@ int main(int argc, char* argv[]) {
     return RC_INVALID_OPERATION;
   }
 
-  FILE *output = fopen(argv[2], "w");
-  int res = write_ppm(output, im);
-  fclose(output);
+  // a failed operation leaves im with us; never write it out
+  if(result == NULL){
+    printf("Error: The %s operation failed\n", argv[3]);
+    free_image(&im);
+    return RC_UNSPECIFIED_ERR;
+  }
+  im = result;
+
+  int res = write_output(argv[2], im);
 
+  // Free image
+  free_image(&im);
+  return res;
+}
+
+/* parse a sweep argument of the form start:stop:step;
+ * return 1 if arg is a sweep, 0 if it is a single value
+ */
+int parse_sweep(const char *arg, int *start, int *stop, int *step) {
+  char extra;
+  return sscanf(arg, "%d:%d:%d%c", start, stop, step, &extra) == 3;
+}
+
+/* build the output filename for one sweep value by inserting
+ * _<value> before the extension, e.g. out.ppm -> out_10.ppm;
+ * return -1 if the buffer is too small
+ */
+int sweep_filename(const char *out, int value, char *buf, size_t size) {
+  const char *slash = strrchr(out, '/');
+  const char *dot = strrchr(out, '.');
+  if (!dot || (slash && dot < slash)) {
+    dot = out + strlen(out);
+  }
+  int n = snprintf(buf, size, "%.*s_%d%s", (int)(dot - out), out, value, dot);
+  return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+/* return 1 if the filename ends in .qoi (any case), otherwise 0 */
+int is_qoi(const char *filename) {
+  size_t len = strlen(filename);
+  if (len < 4) {
+    return 0;
+  }
+  const char *ext = filename + len - 4;
+  return ext[0] == '.' && tolower((unsigned char)ext[1]) == 'q' &&
+         tolower((unsigned char)ext[2]) == 'o' && tolower((unsigned char)ext[3]) == 'i';
+}
+
+/* write an image to the given file as PPM or QOI depending on
+ * its extension, returning a project return code */
+int write_output(const char *filename, const Image *im) {
+  FILE *output = fopen(filename, "w");
+  if(output==NULL){
+    printf("Error: Could not open output file %s\n", filename);
+    return RC_WRITE_FAILED;
+  }
+  int res = is_qoi(filename) ? write_qoi(output, im) : write_ppm(output, im);
+  fclose(output);
 
   // check for writing error
   if(res==-1){
     printf("Error: Invalid image was given or there was an error in writing the file\n");
-    free_image(&im);
     return RC_WRITE_FAILED;
   }
-
-  // Free image
-  free_image(&im);
   return RC_SUCCESS;
 }
 
+/* parse an automatic threshold: "auto" (Otsu, percent set to -1)
+ * or "auto:<percent>" with 0 <= percent <= 100; return 1 if arg is
+ * one, -1 if it starts with "auto" but is malformed, otherwise 0
+ */
+int parse_auto(const char *arg, double *percent) {
+  if (strncmp(arg, "auto", 4)) {
+    return 0;
+  }
+  if (!strcmp(arg, "auto")) {
+    *percent = -1;
+    return 1;
+  }
+  char extra;
+  if (sscanf(arg, "auto:%lf%c", percent, &extra) != 1 ||
+      !isfinite(*percent) || *percent < 0 || *percent > 100) {
+    return -1;
+  }
+  return 1;
+}
+
+/* parse a byte count with an optional k, M or G suffix;
+ * return 1 if valid, otherwise 0
+ */
+int parse_size(const char *arg, size_t *size) {
+  char *end;
+  errno = 0;
+  unsigned long long n = strtoull(arg, &end, 10);
+  if (end == arg || arg[0] == '-' || errno == ERANGE || n > SIZE_MAX) {
+    return 0;
+  }
+  int shifts = 0;
+  switch (toupper((unsigned char)*end)) {
+    case 'G': shifts = 3; end++; break;
+    case 'M': shifts = 2; end++; break;
+    case 'K': shifts = 1; end++; break;
+    case '\0': break;
+    default: return 0;
+  }
+  for (int i = 0; i < shifts; i++) {
+    // a larger value would wrap around into a small budget
+    if (n > (SIZE_MAX >> 10)) {
+      return 0;
+    }
+    n <<= 10;
+  }
+  if (*end != '\0' || n == 0) {
+    return 0;
+  }
+  *size = (size_t)n;
+  return 1;
+}
+
+/* rotate a PPM right without loading it, holding at most
+ * the given budget of pixels in memory
+ */
+int rotate_out_of_core(const char *in, const char *out, const char *budget) {
+  size_t bytes;
+  if (!parse_size(budget, &bytes)) {
+    printf("Error: Incorrect range for the parameters of rotate-right function");
+    return RC_OP_ARGS_RANGE_ERR;
+  }
+  if (is_qoi(in) || is_qoi(out)) {
+    printf("Error: Out-of-core rotate-right only supports PPM files\n");
+    return RC_INVALID_OP_ARGS;
+  }
+
+  int res = rotateright_ooc(in, out, bytes, NULL);
+  switch (res) {
+    case OOC_SUCCESS:
+      return RC_SUCCESS;
+    case OOC_OPEN_FAILED:
+      printf("Error: File open has failed; PPM is empty\n");
+      return RC_OPEN_FAILED;
+    case OOC_INVALID_PPM:
+      printf("Error: Given PPM file is invalid\n");
+      return RC_INVALID_PPM;
+    case OOC_BUDGET_SMALL:
+      printf("Error: Incorrect range for the parameters of rotate-right function");
+      return RC_OP_ARGS_RANGE_ERR;
+    case OOC_IO_FAILED:
+      printf("Error: Invalid image was given or there was an error in writing the file\n");
+      return RC_WRITE_FAILED;
+    default:
+      return RC_UNSPECIFIED_ERR;
+  }
+}
+
+/* swirl the image once per strength in start:stop:step,
+ * computing the radius map only once; every strength is resampled
+ * on one context with a thread per CPU
+ */
+int sweep_swirl(Image *im, const char *out, double cx, double cy, int start, int stop, int step) {
+  CbpContext *ctx;
+  if (cbp_context_create(&ctx, 0) != CBP_OK) {
+    printf("Error: Could not start the sweep threads\n");
+    return RC_UNSPECIFIED_ERR;
+  }
+  double *radius = radius_map(im, cx, cy, ctx);
+  if (!radius) {
+    cbp_context_destroy(ctx);
+    return RC_UNSPECIFIED_ERR;
+  }
+
+  int rc = RC_SUCCESS;
+  char filename[FILENAME_MAX];
+  for (int s = start; rc == RC_SUCCESS; s += step) {
+    if (sweep_filename(out, s, filename, sizeof(filename))) {
+      printf("Error: Output filename is too long\n");
+      rc = RC_WRITE_FAILED;
+      break;
+    }
+    Image *result = swirl_from_radius(im, radius, cx, cy, s, ctx);
+    if (!result) {
+      rc = RC_UNSPECIFIED_ERR;
+      break;
+    }
+    rc = write_output(filename, result);
+    free_image(&result);
+
+    // stop here if the next value would pass stop (or overflow)
+    if (s > stop - step) {
+      break;
+    }
+  }
+
+  free(radius);
+  cbp_context_destroy(ctx);
+  return rc;
+}
+
+/* edge-detect the image once per threshold in start:stop:step,
+ * computing the grayscale conversion and gradients only once,
+ * on one context shared by every threshold as in sweep_swirl
+ */
+int sweep_edges(Image *im, const char *out, int start, int stop, int step) {
+  CbpContext *ctx;
+  if (cbp_context_create(&ctx, 0) != CBP_OK) {
+    printf("Error: Could not start the sweep threads\n");
+    return RC_UNSPECIFIED_ERR;
+  }
+  double *mag = gradient_magnitude(im, ctx);
+  if (!mag) {
+    cbp_context_destroy(ctx);
+    return RC_UNSPECIFIED_ERR;
+  }
+
+  int rc = RC_SUCCESS;
+  char filename[FILENAME_MAX];
+  for (int t = start; rc == RC_SUCCESS; t += step) {
+    if (sweep_filename(out, t, filename, sizeof(filename))) {
+      printf("Error: Output filename is too long\n");
+      rc = RC_WRITE_FAILED;
+      break;
+    }
+    Image *result = threshold_edges(im, mag, t, ctx);
+    if (!result) {
+      rc = RC_UNSPECIFIED_ERR;
+      break;
+    }
+    rc = write_output(filename, result);
+    free_image(&result);
+
+    // stop here if the next value would pass stop (or overflow)
+    if (t > stop - step) {
+      break;
+    }
+  }
+
+  free(mag);
+  cbp_context_destroy(ctx);
+  return rc;
+}
+
 void print_usage() {
   printf("USAGE: ./project <input-image> <output-image> <command-name> <command-args>\n");
   printf("SUPPORTED COMMANDS:\n");
   printf("   swap\n");
   printf("   invert\n");
-  printf("   zoom-out\n");
-  printf("   rotate-right\n");
+  printf("   zoom-out [<factor>]\n");
+  printf("   rotate-right [<memory-budget>]\n");
   printf("   swirl <cx> <cy> <strength>\n");
   printf("   edge-detection <threshold>\n");
+  printf("   blur <radius>\n");
+  printf("   auto-levels\n");
+  printf("Images ending in .qoi are read/written as QOI, all others as PPM\n");
+  printf("With a memory budget (bytes, or with a k/M/G suffix) rotate-right works\n");
+  printf("out of core, for PPM images too large to load; its scratch file goes\n");
+  printf("in $TMPDIR if set, otherwise next to <output-image>\n");
+  printf("An edge-detection <threshold> of auto picks it by Otsu's method, and\n");
+  printf("auto:<percent> picks that percentile of the gradient magnitudes\n");
+  printf("A <strength> or <threshold> of the form start:stop:step sweeps over\n");
+  printf("those values, writing one output per value named <output-image>_<value>\n");
 }
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "qoi_io.h"
+
+// chunk tags, see the QOI specification
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_OP_RGBA  0xff
+#define QOI_MASK_2   0xc0
+
+// longest run a single QOI_OP_RUN can hold
+#define QOI_MAX_RUN 62
+
+// upper bound on pixels, guards rows*cols overflow on bad headers
+#define QOI_MAX_PIXELS 400000000
+
+// position of a pixel in the 64-entry index
+#define QOI_HASH(p) (((p)[0]*3 + (p)[1]*5 + (p)[2]*7 + (p)[3]*11) % 64)
+
+static const unsigned char qoi_padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+/* HELPER for the encoder:
+ * write the buffered bytes to the file
+ */
+static int qoi_flush(QoiEncoder *enc) {
+  if (enc->len && fwrite(enc->buf, 1, enc->len, enc->fp) != enc->len) {
+    fprintf(stderr, "Error:qoi_io - failed to write data to file\n");
+    return -1;
+  }
+  enc->len = 0;
+  return 0;
+}
+
+/* HELPER for the encoder:
+ * append one byte to the buffer, flushing it when full
+ */
+static int qoi_put(QoiEncoder *enc, unsigned char byte) {
+  if (enc->len == QOI_BUFFER_SIZE && qoi_flush(enc)) {
+    return -1;
+  }
+  enc->buf[enc->len++] = byte;
+  return 0;
+}
+
+/* HELPER for the encoder:
+ * write a 32-bit big-endian value
+ */
+static int qoi_put32(QoiEncoder *enc, unsigned long v) {
+  if (qoi_put(enc, (v >> 24) & 0xff) || qoi_put(enc, (v >> 16) & 0xff) ||
+      qoi_put(enc, (v >> 8) & 0xff) || qoi_put(enc, v & 0xff)) {
+    return -1;
+  }
+  return 0;
+}
+
+/* HELPER for the decoder:
+ * read a 32-bit big-endian value; return -1 on EOF
+ */
+static long qoi_get32(FILE *fp) {
+  long v = 0;
+  for (int i = 0; i < 4; i++) {
+    int ch = getc(fp);
+    if (ch == EOF) {
+      return -1;
+    }
+    v = (v << 8) | ch;
+  }
+  return v;
+}
+
+
+int qoi_encode_begin(QoiEncoder *enc, FILE *fp, int rows, int cols) {
+  assert(enc != NULL && fp != NULL);
+
+  if (rows <= 0 || cols <= 0) {
+    fprintf(stderr, "Error:qoi_io - non-positive image dimensions\n");
+    return -1;
+  }
+
+  enc->fp = fp;
+  memset(enc->index, 0, sizeof(enc->index));
+  enc->prev[0] = enc->prev[1] = enc->prev[2] = 0;
+  enc->prev[3] = 255;
+  enc->run = 0;
+  enc->len = 0;
+
+  // magic, width, height, channels (RGB), colorspace (sRGB)
+  if (qoi_put(enc, 'q') || qoi_put(enc, 'o') || qoi_put(enc, 'i') || qoi_put(enc, 'f') ||
+      qoi_put32(enc, cols) || qoi_put32(enc, rows) ||
+      qoi_put(enc, 3) || qoi_put(enc, 0)) {
+    return -1;
+  }
+  return 0;
+}
+
+int qoi_encode_pixels(QoiEncoder *enc, const Pixel *px, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    unsigned char cur[4] = {px[i].r, px[i].g, px[i].b, 255};
+
+    // extend the current run while the pixel repeats
+    if (!memcmp(cur, enc->prev, 4)) {
+      enc->run++;
+      if (enc->run == QOI_MAX_RUN) {
+        if (qoi_put(enc, QOI_OP_RUN | (enc->run - 1))) {
+          return -1;
+        }
+        enc->run = 0;
+      }
+      continue;
+    }
+
+    if (enc->run > 0) {
+      if (qoi_put(enc, QOI_OP_RUN | (enc->run - 1))) {
+        return -1;
+      }
+      enc->run = 0;
+    }
+
+    int pos = QOI_HASH(cur);
+    int err;
+    if (!memcmp(enc->index[pos], cur, 4)) {
+      err = qoi_put(enc, QOI_OP_INDEX | pos);
+    }
+    else {
+      memcpy(enc->index[pos], cur, 4);
+
+      // channel differences wrap around, as in the specification
+      signed char dr = (signed char)(cur[0] - enc->prev[0]);
+      signed char dg = (signed char)(cur[1] - enc->prev[1]);
+      signed char db = (signed char)(cur[2] - enc->prev[2]);
+      signed char dr_dg = (signed char)(dr - dg);
+      signed char db_dg = (signed char)(db - dg);
+
+      if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+        err = qoi_put(enc, QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+      }
+      else if (dg > -33 && dg < 32 && dr_dg > -9 && dr_dg < 8 && db_dg > -9 && db_dg < 8) {
+        err = qoi_put(enc, QOI_OP_LUMA | (dg + 32)) ||
+              qoi_put(enc, (dr_dg + 8) << 4 | (db_dg + 8));
+      }
+      else {
+        err = qoi_put(enc, QOI_OP_RGB) || qoi_put(enc, cur[0]) ||
+              qoi_put(enc, cur[1]) || qoi_put(enc, cur[2]);
+      }
+    }
+    if (err) {
+      return -1;
+    }
+    memcpy(enc->prev, cur, 4);
+  }
+  return 0;
+}
+
+int qoi_encode_end(QoiEncoder *enc) {
+  if (enc->run > 0) {
+    if (qoi_put(enc, QOI_OP_RUN | (enc->run - 1))) {
+      return -1;
+    }
+    enc->run = 0;
+  }
+  for (int i = 0; i < 8; i++) {
+    if (qoi_put(enc, qoi_padding[i])) {
+      return -1;
+    }
+  }
+  return qoi_flush(enc);
+}
+
+
+int qoi_decode_begin(QoiDecoder *dec, FILE *fp) {
+  assert(dec != NULL && fp != NULL);
+
+  char magic[4];
+  if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, "qoif", 4)) {
+    fprintf(stderr, "Error:qoi_io - not a QOI (bad magic)\n");
+    return -1;
+  }
+
+  long cols = qoi_get32(fp);
+  long rows = qoi_get32(fp);
+  int channels = getc(fp);
+  int colorspace = getc(fp);
+  if (cols <= 0 || rows <= 0 || cols > QOI_MAX_PIXELS / rows) {
+    fprintf(stderr, "Error:qoi_io - QOI file with bad dimensions\n");
+    return -1;
+  }
+  if ((channels != 3 && channels != 4) || (colorspace != 0 && colorspace != 1)) {
+    fprintf(stderr, "Error:qoi_io - QOI file with bad channels or colorspace\n");
+    return -1;
+  }
+
+  dec->fp = fp;
+  memset(dec->index, 0, sizeof(dec->index));
+  dec->prev[0] = dec->prev[1] = dec->prev[2] = 0;
+  dec->prev[3] = 255;
+  dec->run = 0;
+  dec->rows = (int)rows;
+  dec->cols = (int)cols;
+  return 0;
+}
+
+int qoi_decode_pixels(QoiDecoder *dec, Pixel *px, size_t n) {
+  FILE *fp = dec->fp;
+  unsigned char *p = dec->prev;
+
+  for (size_t i = 0; i < n; i++) {
+    if (dec->run > 0) {
+      dec->run--;
+    }
+    else {
+      int b1 = getc(fp);
+      if (b1 == EOF) {
+        fprintf(stderr, "Error:qoi_io - unexpected end of file\n");
+        return -1;
+      }
+
+      if (b1 == QOI_OP_RGB || b1 == QOI_OP_RGBA) {
+        int n_bytes = (b1 == QOI_OP_RGB) ? 3 : 4;
+        for (int c = 0; c < n_bytes; c++) {
+          int ch = getc(fp);
+          if (ch == EOF) {
+            fprintf(stderr, "Error:qoi_io - unexpected end of file\n");
+            return -1;
+          }
+          p[c] = (unsigned char)ch;
+        }
+      }
+      else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+        memcpy(p, dec->index[b1], 4);
+      }
+      else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+        p[0] += ((b1 >> 4) & 0x03) - 2;
+        p[1] += ((b1 >> 2) & 0x03) - 2;
+        p[2] += (b1 & 0x03) - 2;
+      }
+      else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+        int b2 = getc(fp);
+        if (b2 == EOF) {
+          fprintf(stderr, "Error:qoi_io - unexpected end of file\n");
+          return -1;
+        }
+        int dg = (b1 & 0x3f) - 32;
+        p[0] += dg - 8 + ((b2 >> 4) & 0x0f);
+        p[1] += dg;
+        p[2] += dg - 8 + (b2 & 0x0f);
+      }
+      else {
+        // QOI_OP_RUN; this pixel is the first of the run
+        dec->run = b1 & 0x3f;
+      }
+      memcpy(dec->index[QOI_HASH(p)], p, 4);
+    }
+
+    px[i].r = p[0];
+    px[i].g = p[1];
+    px[i].b = p[2];
+  }
+  return 0;
+}
+
+
+Image * read_qoi(FILE *fp) {
+
+  /* confirm that we received a good file handle */
+  assert(fp != NULL);
+
+  QoiDecoder dec;
+  if (qoi_decode_begin(&dec, fp)) {
+    return NULL;
+  }
+
+  Image *im = make_image(dec.rows, dec.cols);
+  if (!im) {
+    fprintf(stderr, "Error:qoi_io - failed to allocate memory for image!\n");
+    return NULL;
+  }
+
+  if (qoi_decode_pixels(&dec, im->data, (size_t)im->rows * im->cols)) {
+    free_image(&im);
+    return NULL;
+  }
+  return im;
+}
+
+/* Write given image to disk as a QOI.
+ * Return -1 if any failure occurs, otherwise return the number of pixels written.
+ */
+int write_qoi(FILE *fp, const Image *im) {
+  if (!fp || im->cols <= 0 || im->rows <= 0 || im->data == NULL) {
+    fprintf(stderr, "Error:qoi_io - invalid image or file was given\n");
+    return -1;
+  }
+
+  // encoder state holds a large output buffer, so keep it off the stack
+  QoiEncoder *enc = malloc(sizeof(QoiEncoder));
+  if (!enc) {
+    fprintf(stderr, "Error:qoi_io - failed to allocate encoder\n");
+    return -1;
+  }
+
+  int res = -1;
+  if (!qoi_encode_begin(enc, fp, im->rows, im->cols) &&
+      !qoi_encode_pixels(enc, im->data, (size_t)im->rows * im->cols) &&
+      !qoi_encode_end(enc)) {
+    res = im->rows * im->cols;
+  }
+  free(enc);
+  return res;
+}
@@ -0,0 +1,66 @@
+#ifndef QOI_IO_H
+#define QOI_IO_H
+
+#include <stdio.h>
+#include "ppm_io.h"
+
+/* Fast lossless "Quite OK Image" (QOI) format, RGB only.
+ * Files are written with 3 channels and read back as RGB; an alpha
+ * channel in the input is decoded but dropped.
+ */
+
+// size of the encoder's output buffer, in bytes
+#define QOI_BUFFER_SIZE 65536
+
+/* state of a streaming QOI encoder; pixels may be fed in any number
+ * of chunks, in row-major order */
+typedef struct _qoi_encoder {
+  FILE *fp;
+  unsigned char index[64][4];   // previously seen pixels, RGBA
+  unsigned char prev[4];        // last pixel written, RGBA
+  int run;                      // length of the pending run
+  size_t len;                   // bytes pending in buf
+  unsigned char buf[QOI_BUFFER_SIZE];
+} QoiEncoder;
+
+/* state of a streaming QOI decoder */
+typedef struct _qoi_decoder {
+  FILE *fp;
+  unsigned char index[64][4];
+  unsigned char prev[4];
+  int run;
+  int rows;
+  int cols;
+} QoiDecoder;
+
+
+/* write the QOI header for a rows x cols image and
+ * initialize the encoder; return -1 on failure, otherwise 0 */
+int qoi_encode_begin(QoiEncoder *enc, FILE *fp, int rows, int cols);
+
+/* encode the next n pixels; return -1 on failure, otherwise 0 */
+int qoi_encode_pixels(QoiEncoder *enc, const Pixel *px, size_t n);
+
+/* flush any pending run and write the end marker;
+ * return -1 on failure, otherwise 0 */
+int qoi_encode_end(QoiEncoder *enc);
+
+
+/* read the QOI header and initialize the decoder; the image size
+ * is left in dec->rows and dec->cols. Return -1 on failure, otherwise 0 */
+int qoi_decode_begin(QoiDecoder *dec, FILE *fp);
+
+/* decode the next n pixels into px; return -1 on failure, otherwise 0 */
+int qoi_decode_pixels(QoiDecoder *dec, Pixel *px, size_t n);
+
+
+/* read QOI formatted image from a file (assumes fp != NULL) */
+Image * read_qoi(FILE *fp);
+
+/* Write given image to disk as a QOI.
+ * Return -1 if any failure occurs, otherwise return the number of pixels written.
+ */
+int write_qoi(FILE *fp, const Image *im);
+
+
+#endif
@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rotate_ooc.h"
+#include "ppm_io.h"
+
+// columns transposed together, to keep the band reads cache friendly
+#define OOC_BLOCK 64
+
+size_t rotateright_ooc_min_budget(int rows, int cols) {
+  // phase 1 holds a one-row band and its tile, phase 2 one output row
+  size_t band = (size_t)cols * 3 * 2;
+  size_t group = (size_t)rows * 3;
+  return band > group ? band : group;
+}
+
+/* HELPER for rotateright_ooc:
+ * rotate a band of h source rows into a tile holding, for each source
+ * column c, its h pixels read bottom to top (a piece of output row c)
+ */
+static void rotate_band(const unsigned char *band, unsigned char *tile, int h, int cols) {
+  for (int cb = 0; cb < cols; cb += OOC_BLOCK) {
+    int ce = cb + OOC_BLOCK < cols ? cb + OOC_BLOCK : cols;
+    for (int j = 0; j < h; j++) {
+      const unsigned char *s = band + (size_t)(h - 1 - j) * cols * 3;
+      for (int c = cb; c < ce; c++) {
+        memcpy(tile + ((size_t)c * h + j) * 3, s + (size_t)c * 3, 3);
+      }
+    }
+  }
+}
+
+/* HELPER for rotateright_ooc:
+ * phase 1, write the tile of every band of h rows to scratch
+ */
+static int write_tiles(FILE *in, FILE *scratch, int rows, int cols, int h) {
+  unsigned char *band = malloc((size_t)h * cols * 3);
+  unsigned char *tile = malloc((size_t)h * cols * 3);
+  if (!band || !tile) {
+    fprintf(stderr, "Error:rotate_ooc - failed to allocate band buffers\n");
+    free(band);
+    free(tile);
+    return OOC_NO_MEMORY;
+  }
+
+  int res = OOC_SUCCESS;
+  for (int r0 = 0; r0 < rows; r0 += h) {
+    int hb = rows - r0 < h ? rows - r0 : h;
+    size_t n = (size_t)hb * cols * 3;
+    if (fread(band, 1, n, in) != n) {
+      fprintf(stderr, "Error:rotate_ooc - failed to read data from file!\n");
+      res = OOC_INVALID_PPM;
+      break;
+    }
+    rotate_band(band, tile, hb, cols);
+    if (fwrite(tile, 1, n, scratch) != n) {
+      fprintf(stderr, "Error:rotate_ooc - failed to write scratch file\n");
+      res = OOC_IO_FAILED;
+      break;
+    }
+  }
+
+  free(band);
+  free(tile);
+  return res;
+}
+
+/* HELPER for rotateright_ooc:
+ * phase 2, assemble k output rows at a time from the tiles and
+ * write them out; output row c holds the pieces of row c of every
+ * tile, the last band's first
+ */
+static int merge_tiles(FILE *scratch, FILE *out, int rows, int cols, int h, int k) {
+  unsigned char *group = malloc((size_t)k * rows * 3);
+  if (!group) {
+    fprintf(stderr, "Error:rotate_ooc - failed to allocate output buffer\n");
+    return OOC_NO_MEMORY;
+  }
+
+  int res = OOC_SUCCESS;
+  for (int c0 = 0; c0 < cols && res == OOC_SUCCESS; c0 += k) {
+    int kb = cols - c0 < k ? cols - c0 : k;
+
+    for (int r0 = 0; r0 < rows; r0 += h) {
+      int hb = rows - r0 < h ? rows - r0 : h;
+      // pieces of rows c0..c0+kb-1 are contiguous within the tile
+      off_t offset = ((off_t)r0 * cols + (off_t)c0 * hb) * 3;
+      if (fseeko(scratch, offset, SEEK_SET)) {
+        res = OOC_IO_FAILED;
+        break;
+      }
+      unsigned char *dst = group + (size_t)(rows - r0 - hb) * 3;
+      for (int i = 0; i < kb; i++) {
+        if (fread(dst + (size_t)i * rows * 3, 3, hb, scratch) != (size_t)hb) {
+          res = OOC_IO_FAILED;
+          break;
+        }
+      }
+      if (res != OOC_SUCCESS) {
+        break;
+      }
+    }
+
+    if (res == OOC_SUCCESS &&
+        fwrite(group, 3, (size_t)kb * rows, out) != (size_t)kb * rows) {
+      res = OOC_IO_FAILED;
+    }
+  }
+  if (res == OOC_IO_FAILED) {
+    fprintf(stderr, "Error:rotate_ooc - failed to merge tiles into output\n");
+  }
+
+  free(group);
+  return res;
+}
+
+/* HELPER for rotateright_ooc:
+ * create and open a new file named prefix followed by six random
+ * characters, storing its name; NULL on failure
+ */
+static FILE *open_temp(const char *prefix, char *name, size_t size) {
+  int n = snprintf(name, size, "%sXXXXXX", prefix);
+  if (n < 0 || (size_t)n >= size) {
+    return NULL;
+  }
+  int fd = mkstemp(name);
+  if (fd < 0) {
+    return NULL;
+  }
+  FILE *fp = fdopen(fd, "w+");
+  if (!fp) {
+    close(fd);
+    remove(name);
+  }
+  return fp;
+}
+
+/* HELPER for rotateright_ooc:
+ * open the scratch file in dir; it is unlinked at once, so it
+ * disappears when closed
+ */
+static FILE *open_scratch(const char *dir) {
+  char prefix[FILENAME_MAX];
+  char name[FILENAME_MAX];
+  int n = snprintf(prefix, sizeof(prefix), "%s/cbitphoto-scratch-", dir);
+  if (n < 0 || (size_t)n >= sizeof(prefix)) {
+    return NULL;
+  }
+  FILE *fp = open_temp(prefix, name, sizeof(name));
+  if (fp) {
+    remove(name);
+  }
+  return fp;
+}
+
+/* HELPER for rotateright_ooc:
+ * rotate from in to out with the given scratch file
+ */
+static int rotate_streams(FILE *in, FILE *out, FILE *scratch, size_t budget) {
+  int rows, cols;
+  if (read_ppm_header(in, &rows, &cols)) {
+    return OOC_INVALID_PPM;
+  }
+  if (budget < rotateright_ooc_min_budget(rows, cols)) {
+    fprintf(stderr, "Error:rotate_ooc - memory budget of %lu bytes is below the %lu needed\n",
+            (unsigned long)budget, (unsigned long)rotateright_ooc_min_budget(rows, cols));
+    return OOC_BUDGET_SMALL;
+  }
+
+  // rows per band (band + tile) and output rows per group
+  size_t h = budget / ((size_t)cols * 3 * 2);
+  size_t k = budget / ((size_t)rows * 3);
+  if (h > (size_t)rows) {
+    h = rows;
+  }
+  if (k > (size_t)cols) {
+    k = cols;
+  }
+
+  int res = write_tiles(in, scratch, rows, cols, (int)h);
+  if (res == OOC_SUCCESS) {
+    write_ppm_header(out, cols, rows);
+    res = merge_tiles(scratch, out, rows, cols, (int)h, (int)k);
+  }
+  return res;
+}
+
+int rotateright_ooc(const char *in, const char *out, size_t budget, const char *scratch_dir) {
+  FILE *input = fopen(in, "r");
+  if (!input) {
+    fprintf(stderr, "Error:rotate_ooc - failed to open %s\n", in);
+    return OOC_OPEN_FAILED;
+  }
+
+  // scratch goes in scratch_dir, $TMPDIR, or the output's directory
+  char dir[FILENAME_MAX];
+  const char *slash = strrchr(out, '/');
+  if (!scratch_dir) {
+    scratch_dir = getenv("TMPDIR");
+  }
+  if (scratch_dir && *scratch_dir) {
+    snprintf(dir, sizeof(dir), "%s", scratch_dir);
+  }
+  else if (slash) {
+    snprintf(dir, sizeof(dir), "%.*s", (int)(slash - out + (slash == out)), out);
+  }
+  else {
+    snprintf(dir, sizeof(dir), ".");
+  }
+
+  // write next to the output and rename over it only on success
+  char tmp_prefix[FILENAME_MAX];
+  char tmp_name[FILENAME_MAX];
+  snprintf(tmp_prefix, sizeof(tmp_prefix), "%s.", out);
+  FILE *output = open_temp(tmp_prefix, tmp_name, sizeof(tmp_name));
+  FILE *scratch = open_scratch(dir);
+  if (!output || !scratch) {
+    fprintf(stderr, "Error:rotate_ooc - failed to create temporary files\n");
+    if (output) {
+      fclose(output);
+      remove(tmp_name);
+    }
+    if (scratch) {
+      fclose(scratch);
+    }
+    fclose(input);
+    return OOC_IO_FAILED;
+  }
+
+  int res = rotate_streams(input, output, scratch, budget);
+  fclose(input);
+  fclose(scratch);
+
+  // mkstemp creates the file 0600; give it the usual permissions
+  mode_t mask = umask(0);
+  umask(mask);
+  if (fchmod(fileno(output), 0666 & ~mask) && res == OOC_SUCCESS) {
+    res = OOC_IO_FAILED;
+  }
+  if (fclose(output) && res == OOC_SUCCESS) {
+    res = OOC_IO_FAILED;
+  }
+  if (res == OOC_SUCCESS && rename(tmp_name, out)) {
+    fprintf(stderr, "Error:rotate_ooc - failed to move output into place\n");
+    res = OOC_IO_FAILED;
+  }
+  if (res != OOC_SUCCESS) {
+    remove(tmp_name);
+  }
+  return res;
+}
@@ -0,0 +1,38 @@
+#ifndef ROTATE_OOC_H
+#define ROTATE_OOC_H
+
+#include <stddef.h>
+
+/* Out-of-core rotate-right for PPM images larger than memory.
+ *
+ * The source is read in bands of rows; each band is rotated into a
+ * tile that is appended to a scratch file. The output rows are then
+ * assembled a group at a time from every tile, so all file I/O is in
+ * large sequential chunks and at most budget bytes of pixel buffers
+ * are held at once.
+ *
+ * The output is written to a temporary file next to it and renamed
+ * into place only on success, so a failed run (or an output path
+ * equal to the input) never destroys an existing file.
+ */
+
+// return codes of rotateright_ooc
+#define OOC_SUCCESS        0
+#define OOC_INVALID_PPM   -1   // input is not a 255-color P6
+#define OOC_BUDGET_SMALL  -2   // budget cannot hold one row of each phase
+#define OOC_IO_FAILED     -3   // read, write or scratch file failure
+#define OOC_NO_MEMORY     -4   // buffers could not be allocated
+#define OOC_OPEN_FAILED   -5   // input could not be opened
+
+/* smallest budget, in bytes, that can rotate a rows x cols image */
+size_t rotateright_ooc_min_budget(int rows, int cols);
+
+/* rotate the P6 image in file `in` clockwise 90 degrees and write it
+ * as P6 to file `out`, using at most budget bytes of pixel buffers
+ * plus a scratch file the size of the image. The scratch file goes
+ * in scratch_dir; if that is NULL, in $TMPDIR when set, otherwise
+ * next to the output (never in a RAM-backed /tmp by default) */
+int rotateright_ooc(const char *in, const char *out, size_t budget, const char *scratch_dir);
+
+
+#endif
@@ -0,0 +1,157 @@
+#include <string.h>
+#include "sat.h"
+
+/* arguments shared by the row loops below */
+typedef struct _sat_job {
+  const SumTable *t;
+  const unsigned char *src;
+  unsigned char *dst;
+  ptrdiff_t stride;
+  int n;                    // blur radius or downscale factor
+} SatJob;
+
+// first entry of table row r (row 0 is all zeros)
+#define SAT_ROW(t, r) ((t)->sum + (size_t)(r) * ((t)->cols + 1) * 3)
+
+
+size_t sum_table_entries(int rows, int cols) {
+  return (size_t)(rows + 1) * (cols + 1) * 3;
+}
+
+/* HELPER for build_sum_table:
+ * horizontal prefix sums of image rows [begin, end) into table rows
+ * begin+1 .. end
+ */
+static void sat_row_sums(void *arg, int begin, int end) {
+  const SatJob *job = arg;
+  const SumTable *t = job->t;
+  for (int r = begin; r < end; r++) {
+    const unsigned char *s = job->src + r * job->stride;
+    unsigned long long *row = SAT_ROW(t, r + 1);
+    unsigned long long acc[3] = {0, 0, 0};
+    row[0] = row[1] = row[2] = 0;
+    for (int c = 0; c < t->cols; c++) {
+      for (int k = 0; k < 3; k++) {
+        acc[k] += s[3*c+k];
+        row[3*(c+1)+k] = acc[k];
+      }
+    }
+  }
+}
+
+/* HELPER for build_sum_table:
+ * vertical prefix sums of table entries [begin, end) of each row
+ */
+static void sat_col_sums(void *arg, int begin, int end) {
+  const SatJob *job = arg;
+  const SumTable *t = job->t;
+  for (int r = 2; r <= t->rows; r++) {
+    const unsigned long long *above = SAT_ROW(t, r - 1);
+    unsigned long long *row = SAT_ROW(t, r);
+    for (int i = begin; i < end; i++) {
+      row[i] += above[i];
+    }
+  }
+}
+
+void build_sum_table(SumTable *t, unsigned long long *sum, const unsigned char *data,
+                     int rows, int cols, ptrdiff_t stride, ThreadPool *pool) {
+  t->sum = sum;
+  t->rows = rows;
+  t->cols = cols;
+  memset(sum, 0, sizeof(unsigned long long) * (cols + 1) * 3);
+
+  SatJob job = { .t = t, .src = data, .stride = stride };
+  if (pool_threads(pool) > 1) {
+    pool_run(pool, rows, sat_row_sums, &job);
+    pool_run(pool, (cols + 1) * 3, sat_col_sums, &job);
+    return;
+  }
+
+  // single pass: running row sum plus the entry above
+  for (int r = 0; r < rows; r++) {
+    const unsigned char *s = data + r * stride;
+    const unsigned long long *above = SAT_ROW(t, r);
+    unsigned long long *row = SAT_ROW(t, r + 1);
+    unsigned long long acc[3] = {0, 0, 0};
+    row[0] = row[1] = row[2] = 0;
+    for (int c = 0; c < cols; c++) {
+      for (int k = 0; k < 3; k++) {
+        acc[k] += s[3*c+k];
+        row[3*(c+1)+k] = acc[k] + above[3*(c+1)+k];
+      }
+    }
+  }
+}
+
+void sum_table_box(const SumTable *t, int r0, int c0, int r1, int c1,
+                   unsigned long long out[3]) {
+  const unsigned long long *top = SAT_ROW(t, r0);
+  const unsigned long long *bottom = SAT_ROW(t, r1);
+  for (int k = 0; k < 3; k++) {
+    out[k] = bottom[3*c1+k] - bottom[3*c0+k] - top[3*c1+k] + top[3*c0+k];
+  }
+}
+
+
+/* HELPER for sum_table_blur:
+ * blur output rows [begin, end)
+ */
+static void sat_blur_rows(void *arg, int begin, int end) {
+  const SatJob *job = arg;
+  const SumTable *t = job->t;
+  int radius = job->n;
+  for (int r = begin; r < end; r++) {
+    int r0 = r - radius < 0 ? 0 : r - radius;
+    int r1 = r + radius + 1 > t->rows ? t->rows : r + radius + 1;
+    unsigned char *d = job->dst + r * job->stride;
+    for (int c = 0; c < t->cols; c++) {
+      int c0 = c - radius < 0 ? 0 : c - radius;
+      int c1 = c + radius + 1 > t->cols ? t->cols : c + radius + 1;
+      unsigned long long area = (unsigned long long)(r1 - r0) * (c1 - c0);
+      unsigned long long sums[3];
+      sum_table_box(t, r0, c0, r1, c1, sums);
+      for (int k = 0; k < 3; k++) {
+        d[3*c+k] = (unsigned char)((sums[k] + area / 2) / area);
+      }
+    }
+  }
+}
+
+void sum_table_blur(const SumTable *t, int radius, unsigned char *dst,
+                    ptrdiff_t stride, ThreadPool *pool) {
+  // any larger window covers the whole image, and r + radius + 1
+  // must not overflow
+  int largest = t->rows > t->cols ? t->rows : t->cols;
+  if (radius > largest) {
+    radius = largest;
+  }
+  SatJob job = { .t = t, .dst = dst, .stride = stride, .n = radius };
+  pool_run(pool, t->rows, sat_blur_rows, &job);
+}
+
+/* HELPER for sum_table_downscale:
+ * downscaled output rows [begin, end)
+ */
+static void sat_downscale_rows(void *arg, int begin, int end) {
+  const SatJob *job = arg;
+  const SumTable *t = job->t;
+  int n = job->n;
+  unsigned long long area = (unsigned long long)n * n;
+  for (int r = begin; r < end; r++) {
+    unsigned char *d = job->dst + r * job->stride;
+    for (int c = 0; c < t->cols / n; c++) {
+      unsigned long long sums[3];
+      sum_table_box(t, r*n, c*n, (r+1)*n, (c+1)*n, sums);
+      for (int k = 0; k < 3; k++) {
+        d[3*c+k] = (unsigned char)(sums[k] / area);
+      }
+    }
+  }
+}
+
+void sum_table_downscale(const SumTable *t, int n, unsigned char *dst,
+                         ptrdiff_t stride, ThreadPool *pool) {
+  SatJob job = { .t = t, .dst = dst, .stride = stride, .n = n };
+  pool_run(pool, t->rows / n, sat_downscale_rows, &job);
+}
@@ -0,0 +1,46 @@
+#ifndef SAT_H
+#define SAT_H
+
+#include <stddef.h>
+#include "thread_pool.h"
+
+/* Summed-area table (integral image) of an RGB image with 3 bytes
+ * per pixel. Entry (r, c) holds the per-channel sums of all pixels
+ * above and to the left of (r, c), so the sum over any rectangle
+ * costs four lookups whatever its size.
+ */
+typedef struct _sum_table {
+  unsigned long long *sum;  // (rows+1) x (cols+1) x 3 channels
+  int rows;
+  int cols;
+} SumTable;
+
+
+/* number of entries needed for the table of a rows x cols image */
+size_t sum_table_entries(int rows, int cols);
+
+/* fill t using caller-provided storage of sum_table_entries() entries;
+ * row r of the image starts at data + r * stride. With a NULL pool the
+ * table is built in a single pass, otherwise rows and then columns are
+ * prefix-summed in parallel */
+void build_sum_table(SumTable *t, unsigned long long *sum, const unsigned char *data,
+                     int rows, int cols, ptrdiff_t stride, ThreadPool *pool);
+
+/* per-channel sums over rows [r0, r1) and columns [c0, c1) */
+void sum_table_box(const SumTable *t, int r0, int c0, int r1, int c1,
+                   unsigned long long out[3]);
+
+/* box blur: each pixel becomes the rounded average of the
+ * (2*radius+1)^2 window around it, clipped to the image; dst is
+ * t->rows x t->cols and may be the image the table was built from */
+void sum_table_blur(const SumTable *t, int radius, unsigned char *dst,
+                    ptrdiff_t stride, ThreadPool *pool);
+
+/* downscale by n: each n x n block becomes the (truncated) average of
+ * its pixels; dst is (t->rows/n) x (t->cols/n), and leftover rows and
+ * columns at the bottom and right are dropped as in zoomout */
+void sum_table_downscale(const SumTable *t, int n, unsigned char *dst,
+                         ptrdiff_t stride, ThreadPool *pool);
+
+
+#endif
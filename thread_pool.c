@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "thread_pool.h"
+
+/* what each worker thread needs to find its chunk */
+typedef struct _pool_worker {
+  pthread_t thread;
+  struct _thread_pool *pool;
+  int id;
+} PoolWorker;
+
+struct _thread_pool {
+  PoolWorker *workers;
+  int nthreads;           // workers + the calling thread
+
+  pthread_mutex_t lock;
+  pthread_cond_t start;   // signalled when a new loop is posted
+  pthread_cond_t done;    // signalled when the last worker finishes
+
+  // the loop currently being run
+  PoolTask task;
+  void *arg;
+  int n;
+  unsigned long generation;
+  int pending;            // workers still running the loop
+  int stop;
+};
+
+/* HELPER for pool_run:
+ * the chunk [begin, end) of [0, n) handled by thread i
+ */
+static void pool_chunk(int n, int nthreads, int i, int *begin, int *end) {
+  *begin = (int)((long long)n * i / nthreads);
+  *end = (int)((long long)n * (i + 1) / nthreads);
+}
+
+/* HELPER for make_pool:
+ * body of each worker thread; waits for a loop, runs its chunk
+ */
+static void *pool_worker(void *p) {
+  ThreadPool *pool = ((PoolWorker *)p)->pool;
+  int id = ((PoolWorker *)p)->id;
+
+  unsigned long seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->stop && pool->generation == seen) {
+      pthread_cond_wait(&pool->start, &pool->lock);
+    }
+    if (pool->stop) {
+      break;
+    }
+    seen = pool->generation;
+    PoolTask task = pool->task;
+    void *arg = pool->arg;
+    int begin, end;
+    pool_chunk(pool->n, pool->nthreads, id, &begin, &end);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (begin < end) {
+      task(arg, begin, end);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) {
+      pthread_cond_signal(&pool->done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+ThreadPool * make_pool(int nthreads) {
+  if (nthreads < 1) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = online > 0 ? (int)online : 1;
+  }
+
+  ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+  if (!pool) {
+    return NULL;
+  }
+  pool->nthreads = nthreads;
+  pool->workers = malloc(sizeof(PoolWorker) * nthreads);
+  if (!pool->workers) {
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  // thread 0 is the caller of pool_run, so start the others
+  for (int i = 1; i < nthreads; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].id = i;
+    if (pthread_create(&pool->workers[i].thread, NULL, pool_worker, &pool->workers[i])) {
+      // only workers 1..i-1 were started
+      pool->nthreads = i;
+      free_pool(&pool);
+      return NULL;
+    }
+  }
+  return pool;
+}
+
+void free_pool(ThreadPool **pool) {
+  if (!*pool) {
+    return;
+  }
+
+  pthread_mutex_lock(&(*pool)->lock);
+  (*pool)->stop = 1;
+  pthread_cond_broadcast(&(*pool)->start);
+  pthread_mutex_unlock(&(*pool)->lock);
+
+  for (int i = 1; i < (*pool)->nthreads; i++) {
+    pthread_join((*pool)->workers[i].thread, NULL);
+  }
+
+  pthread_mutex_destroy(&(*pool)->lock);
+  pthread_cond_destroy(&(*pool)->start);
+  pthread_cond_destroy(&(*pool)->done);
+  free((*pool)->workers);
+  free(*pool);
+  *pool = NULL;
+}
+
+int pool_threads(const ThreadPool *pool) {
+  return pool ? pool->nthreads : 1;
+}
+
+void pool_run(ThreadPool *pool, int n, PoolTask task, void *arg) {
+  if (n <= 0) {
+    return;
+  }
+  if (!pool || pool->nthreads == 1 || n == 1) {
+    task(arg, 0, n);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->task = task;
+  pool->arg = arg;
+  pool->n = n;
+  pool->pending = pool->nthreads - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  // the calling thread takes chunk 0
+  int begin, end;
+  pool_chunk(n, pool->nthreads, 0, &begin, &end);
+  if (begin < end) {
+    task(arg, begin, end);
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0) {
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
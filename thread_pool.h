@@ -0,0 +1,32 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/* A fixed set of worker threads that run data-parallel loops.
+ * pool_run splits the range [0, n) into one contiguous chunk per
+ * thread; the calling thread works on the first chunk itself.
+ * A pool runs one loop at a time; callers sharing a pool must
+ * serialize their pool_run calls.
+ */
+
+/* loop body: process items [begin, end) */
+typedef void (*PoolTask)(void *arg, int begin, int end);
+
+typedef struct _thread_pool ThreadPool;
+
+
+/* start a pool of nthreads threads (including the caller);
+ * 0 means one per online CPU. Returns NULL on failure */
+ThreadPool * make_pool(int nthreads);
+
+/* stop the workers, free the pool and set it to NULL */
+void free_pool(ThreadPool **pool);
+
+/* number of threads taking part in pool_run (1 for a NULL pool) */
+int pool_threads(const ThreadPool *pool);
+
+/* run task over [0, n) and wait for it to finish;
+ * a NULL pool runs the whole range on the calling thread */
+void pool_run(ThreadPool *pool, int n, PoolTask task, void *arg);
+
+
+#endif